@@ -1,29 +1,86 @@
 #pragma once
 #include <limits.h>
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <cmath>
 #include <compare>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <vector>
 
+#include "BigIntegerStats.h"
+#include "OperationControl.h"
+
 #ifndef NENIY_BIGINTEGER
 #define NENIY_BIGINTEGER
 
+class BigIntegerView;
+
 class BigInteger {
  public:
   using BlockT = int64_t;  // Для случая с -INT_MIN
   static const int cMaxBlock = 1'000'000'000;
   static const int cBlockSize = 9;
+  static const uint8_t cSerialVersion = 1;
+  static const size_t cSerialHeaderSize = 8;
+  // С NENIY_BIGINTEGER_STATS блоки хранятся с считающим аллокатором, и тип
+  // GetBlocks() меняется; переносимый код использует BlockVector или auto
+#ifdef NENIY_BIGINTEGER_STATS
+  using BlockVector =
+      std::vector<BlockT, BigIntegerStats::CountingAllocator<BlockT>>;
+  using WordVector =
+      std::vector<uint32_t, BigIntegerStats::CountingAllocator<uint32_t>>;
+#else
+  using BlockVector = std::vector<BlockT>;
+  using WordVector = std::vector<uint32_t>;
+#endif
 
   BigInteger(int /*value*/ = 0);
 
+  BigInteger(const BigInteger& /*other*/);
+
+  BigInteger(BigInteger&& /*other*/) noexcept;
+
   explicit BigInteger(unsigned long long /*value*/, size_t /*unused*/);
 
   explicit BigInteger(const char* /*str*/);
 
+  explicit BigInteger(const BigIntegerView& /*view*/);
+
   std::string toString() const;
 
+  std::to_chars_result ToChars(char* /*first*/, char* /*last*/,
+                               int /*base*/ = 10) const;
+
+  std::to_chars_result ToChars(char* /*first*/, char* /*last*/, int /*base*/,
+                               const OperationControl& /*control*/) const;
+
+  std::from_chars_result FromChars(const char* /*first*/, const char* /*last*/,
+                                   int /*base*/ = 10);
+
+  // Прерываемый вариант для систем счисления, отличных от 10, где разбор
+  // стоит O(n^2); при отмене значение не меняется
+  std::from_chars_result FromChars(const char* /*first*/, const char* /*last*/,
+                                   int /*base*/,
+                                   const OperationControl& /*control*/);
+
+  size_t SerializedSize() const;
+
+  size_t Serialize(unsigned char* /*buffer*/, size_t /*size*/) const;
+
+  BigInteger& operator=(const BigInteger& /*other*/);
+
+  BigInteger& operator=(BigInteger&& /*other*/) noexcept;
+
   BigInteger& operator+=(const BigInteger& /*rhs*/);
 
   BigInteger& operator-=(const BigInteger& /*rhs*/);
@@ -34,8 +91,39 @@ class BigInteger {
 
   BigInteger& operator%=(const BigInteger& /*rhs*/);
 
+  // Прерываемые варианты * и DivMod (см. OperationControl); по завершении
+  // сообщают прогресс 1.0
+  BigInteger Multiply(const BigInteger& /*rhs*/,
+                      const OperationControl& /*control*/) const;
+
+  std::pair<BigInteger, BigInteger> DivideWithRemainder(
+      const BigInteger& /*rhs*/, const OperationControl& /*control*/) const;
+
+  // Побитовые операции и сдвиги ведут себя как над бесконечным дополнительным
+  // кодом: -1 == ...111, сдвиг вправо округляет вниз. Они работают с двоичной
+  // формой числа (слова по 32 бита), которая строится из блоков один раз за
+  // O(n^2) и дальше хранится вместе с ними; результат хранится только в
+  // двоичной форме, а блоки восстанавливаются при первом обращении к ним.
+  // Поэтому сдвиг на k бит стоит O(n + k / 32), и цепочка сдвигов и побитовых
+  // операций платит за перевод только на входе и выходе. Если двоичной формы
+  // ещё нет, а один из операндов &, |, ^ неотрицателен и состоит из m блоков,
+  // операция обходится без перевода длинного операнда: & берёт O(m) младших
+  // блоков за O(m^2), а x | m == x + m - (x & m) и x ^ m == x + m - 2 (x & m)
+  // добавляют к этому O(n).
+  BigInteger& operator&=(const BigInteger& /*rhs*/);
+
+  BigInteger& operator|=(const BigInteger& /*rhs*/);
+
+  BigInteger& operator^=(const BigInteger& /*rhs*/);
+
+  BigInteger& operator<<=(size_t /*shift*/);
+
+  BigInteger& operator>>=(size_t /*shift*/);
+
   BigInteger operator-() const;
 
+  BigInteger operator~() const;
+
   BigInteger& operator++();
 
   BigInteger& operator--();
@@ -52,17 +140,130 @@ class BigInteger {
 
   bool IsNegative() const;
 
-  const std::vector<BlockT>& GetBlocks() const;
+  // С двоичной формой TestBit(i) и TrailingZeroBits() читают её слова. Без неё
+  // они читают только младшие блоки: 10^9 делится на 2^9, поэтому x mod 2^k
+  // определяется ceil(k / 9) младшими блоками
+  bool TestBit(size_t /*index*/) const;
+
+  // Длина модуля в битах, BitLength(0) == 0. С двоичной формой (например,
+  // у результата сдвига) O(1). Без неё — оценка по старшим блокам, а если |x|
+  // очень близок к степени двойки (в том числе равен ей), число один раз
+  // переводится в двоичную форму за O(n^2)
+  size_t BitLength() const;
+
+  // Число единичных битов модуля; O(n^2) на перевод в двоичную форму, если её
+  // ещё нет
+  size_t PopCount() const;
+
+  size_t TrailingZeroBits() const;  // Для нуля возвращает 0
+
+  const BlockVector& GetBlocks() const;
 
  private:
   void IncrementLogic();
 
   void DecrementLogic();
 
-  std::pair<BigInteger, BigInteger> DivMod(const BigInteger& /*rhs*/) const;
+  // Частное и остаток за одно деление; control проверяется перед каждым блоком
+  std::pair<BigInteger, BigInteger> DivMod(
+      const BigInteger& /*rhs*/,
+      const OperationControl* /*control*/ = nullptr) const;
+
+  BigInteger& MultiplyAssign(const BigInteger& /*rhs*/,
+                             const OperationControl* /*control*/);
+
+  std::to_chars_result ToCharsImpl(char* /*first*/, char* /*last*/,
+                                   int /*base*/,
+                                   const OperationControl* /*control*/) const;
+
+  std::from_chars_result FromCharsImpl(const char* /*first*/,
+                                       const char* /*last*/, int /*base*/,
+                                       const OperationControl* /*control*/);
+
+  BlockT DivideBySmall(BlockT /*divisor*/);
+
+  void MultiplyAddSmall(BlockT /*multiplier*/, BlockT /*addend*/);
+
+  static int DigitValue(char /*digit*/);
+
+  static BlockT ChunkForBase(int /*base*/, int& /*chunk_digits*/);
+
+  static size_t BlocksForBits(size_t /*bits*/);
+
+  BigInteger LowBlocks(size_t /*count*/) const;
+
+  // Формы модуля: десятичные блоки и двоичные слова, есть хотя бы одна.
+  // Недостающая форма достраивается и в const-методах, поэтому переход
+  // синхронизирован: const-методы можно вызывать из нескольких потоков
+  enum Form : uint8_t { kDecimalForm = 1, kBinaryForm = 2 };
+
+  bool HasForm(Form /*form*/) const;
+
+  void EnsureDecimal() const;
+
+  void EnsureBinary() const;
+
+  void MakeDecimal();  // Оставляет только блоки, чтобы их изменять
+
+  void MakeBinary();  // Оставляет только слова, чтобы их изменять
+
+  size_t LimbCount() const;  // Длина в блоках или словах, для статистики
+
+  static std::mutex& FormMutex();
+
+  static WordVector BlocksToWords(const BlockVector& /*blocks*/);
+
+  static BlockVector WordsToBlocks(const WordVector& /*words*/);
+
+  static void IncrementWords(WordVector& /*words*/);
+
+  static void DecrementWords(WordVector& /*words*/);
+
+  static void TrimWords(WordVector& /*words*/);
+
+  static size_t WordsTrailingZeroBits(const WordVector& /*words*/);
+
+  static BigInteger FromWords(WordVector /*words*/, bool /*negative*/);
+
+  WordVector TwosComplementWords() const;
+
+  bool PreferLowBlocks(const BigInteger& /*rhs*/) const;
+
+  template <typename Op>
+  static BigInteger BitwiseOp(const BigInteger& /*lhs*/,
+                              const BigInteger& /*rhs*/, Op /*op*/);
+
+  static void WriteU32(unsigned char* /*dest*/, uint32_t /*value*/);
 
   bool is_negative_;
-  std::vector<BlockT> blocks_;  // Блоки по 9 цифр (little-endian)
+  mutable BlockVector blocks_;  // Блоки по 9 цифр (little-endian)
+  mutable WordVector words_;    // Слова модуля по 32 бита (little-endian)
+  mutable std::atomic<uint8_t> forms_{kDecimalForm};
+};
+
+// Сериализованный BigInteger поверх чужого буфера (например, mmap), без
+// копирования. Формат (little-endian): [версия][знак][0][0][число блоков u32],
+// затем блоки по 9 цифр, каждый как u32. Конструктор проверяет заголовок и
+// все блоки и бросает std::runtime_error на некорректных данных.
+class BigIntegerView {
+ public:
+  BigIntegerView(const unsigned char* /*data*/, size_t /*size*/);
+
+  bool IsNegative() const;
+
+  bool IsZero() const;
+
+  size_t BlockCount() const;
+
+  BigInteger::BlockT GetBlock(size_t /*index*/) const;
+
+  size_t ByteSize() const;  // Для чтения нескольких чисел подряд
+
+ private:
+  static uint32_t ReadU32(const unsigned char* /*src*/);
+
+  const unsigned char* data_;
+  size_t block_count_;
 };
 
 std::strong_ordering operator<=>(const BigInteger& lhs, const BigInteger& rhs) {
@@ -109,6 +310,20 @@ BigInteger operator""_bi(const char* str,
   return BigInteger(str);
 }
 
+std::to_chars_result to_chars(char* first, char* last, const BigInteger& value,
+                              int base = 10) {
+  return value.ToChars(first, last, base);
+}
+
+std::from_chars_result from_chars(const char* first, const char* last,
+                                  BigInteger& value, int base = 10) {
+  return value.FromChars(first, last, base);
+}
+std::from_chars_result from_chars(std::string_view str, BigInteger& value,
+                                  int base = 10) {
+  return value.FromChars(str.data(), str.data() + str.size(), base);
+}
+
 std::ostream& operator<<(std::ostream& os, const BigInteger& rhs) {
   os << rhs.toString();
   return os;
@@ -157,6 +372,31 @@ BigInteger operator%(const BigInteger& lhs, const BigInteger& rhs) {
   remains %= rhs;
   return remains;
 }
+BigInteger operator&(const BigInteger& lhs, const BigInteger& rhs) {
+  BigInteger result = lhs;
+  result &= rhs;
+  return result;
+}
+BigInteger operator|(const BigInteger& lhs, const BigInteger& rhs) {
+  BigInteger result = lhs;
+  result |= rhs;
+  return result;
+}
+BigInteger operator^(const BigInteger& lhs, const BigInteger& rhs) {
+  BigInteger result = lhs;
+  result ^= rhs;
+  return result;
+}
+BigInteger operator<<(const BigInteger& lhs, size_t shift) {
+  BigInteger result = lhs;
+  result <<= shift;
+  return result;
+}
+BigInteger operator>>(const BigInteger& lhs, size_t shift) {
+  BigInteger result = lhs;
+  result >>= shift;
+  return result;
+}
 
 BigInteger::BigInteger(int value) : is_negative_(value < 0) {
   if (value == INT_MIN) {
@@ -187,6 +427,7 @@ BigInteger::BigInteger(unsigned long long value, size_t /*unused*/)
   }
 }
 BigInteger::BigInteger(const char* str) : is_negative_(*str == '-') {
+  NENIY_STATS_SCOPE(kParse, strlen(str) / cBlockSize + 1);
   if (is_negative_) {
     ++str;
   }
@@ -218,7 +459,51 @@ BigInteger::BigInteger(const char* str) : is_negative_(*str == '-') {
   blocks_.push_back(block);
 }
 
+BigInteger::BigInteger(const BigIntegerView& view)
+    : is_negative_(view.IsNegative()), blocks_(view.BlockCount()) {
+  int sz = blocks_.size();
+  for (int i = 0; i < sz; ++i) {  // Блоки уже проверены конструктором view
+    blocks_[i] = view.GetBlock(i);
+  }
+}
+
+BigInteger::BigInteger(const BigInteger& other)
+    : is_negative_(other.is_negative_) {
+  // Копируются только готовые формы: другой поток может достраивать
+  // недостающую
+  uint8_t forms = other.forms_.load(std::memory_order_acquire);
+  if ((forms & kDecimalForm) != 0) {
+    blocks_ = other.blocks_;
+  }
+  if ((forms & kBinaryForm) != 0) {
+    words_ = other.words_;
+  }
+  forms_.store(forms, std::memory_order_relaxed);
+}
+BigInteger::BigInteger(BigInteger&& other) noexcept
+    : is_negative_(other.is_negative_),
+      blocks_(std::move(other.blocks_)),
+      words_(std::move(other.words_)),
+      forms_(other.forms_.load(std::memory_order_relaxed)) {}
+
+BigInteger& BigInteger::operator=(const BigInteger& other) {
+  if (this != &other) {
+    *this = BigInteger(other);
+  }
+  return *this;
+}
+BigInteger& BigInteger::operator=(BigInteger&& other) noexcept {
+  is_negative_ = other.is_negative_;
+  blocks_ = std::move(other.blocks_);
+  words_ = std::move(other.words_);
+  forms_.store(other.forms_.load(std::memory_order_relaxed),
+               std::memory_order_relaxed);
+  return *this;
+}
+
 std::string BigInteger::toString() const {
+  NENIY_STATS_SCOPE(kToString, LimbCount());
+  EnsureDecimal();
   // Без дополнения нулями (старший разряд)
   std::string bigint =
       (is_negative_ ? "-" : "") + std::to_string(blocks_.back());
@@ -234,7 +519,179 @@ std::string BigInteger::toString() const {
   return bigint;
 }
 
+std::to_chars_result BigInteger::ToChars(char* first, char* last,
+                                         int base) const {
+  return ToCharsImpl(first, last, base, nullptr);
+}
+std::to_chars_result BigInteger::ToChars(
+    char* first, char* last, int base, const OperationControl& control) const {
+  std::to_chars_result result = ToCharsImpl(first, last, base, &control);
+  control.ReportProgress(1.0);
+  return result;
+}
+std::to_chars_result BigInteger::ToCharsImpl(
+    char* first, char* last, int base, const OperationControl* control) const {
+  NENIY_STATS_SCOPE(kToString, LimbCount());
+  ProgressTracker progress(control);
+  EnsureDecimal();
+  if (base < 2 || base > 36) {
+    throw std::invalid_argument("Base must be in [2, 36].");
+  }
+  if (is_negative_) {
+    if (first == last) {
+      return {last, std::errc::value_too_large};
+    }
+    *first++ = '-';
+  }
+
+  if (base == 10) {  // Блоки уже десятичные, деление не нужно
+    auto top = std::to_chars(first, last, blocks_.back());
+    if (top.ec != std::errc()) {
+      return top;
+    }
+    first = top.ptr;
+    int sz = blocks_.size();
+    for (int i = sz - 2; i >= 0; --i) {
+      progress.Checkpoint(sz - 2 - i, sz - 1);
+      if (last - first < cBlockSize) {
+        return {last, std::errc::value_too_large};
+      }
+      BlockT block = blocks_[i];
+      for (int j = cBlockSize - 1; j >= 0; --j) {
+        first[j] = static_cast<char>('0' + block % 10);
+        block /= 10;
+      }
+      first += cBlockSize;
+    }
+    return {first, std::errc()};
+  }
+
+  // Цифры пишутся с младших, затем разворачиваются
+  int chunk_digits;
+  BlockT chunk = ChunkForBase(base, chunk_digits);
+  BigInteger magnitude = *this;
+  magnitude.is_negative_ = false;
+  char* begin = first;
+  size_t total_blocks = magnitude.blocks_.size();
+  do {
+    progress.Checkpoint(total_blocks - magnitude.blocks_.size(), total_blocks);
+    BlockT remainder = magnitude.DivideBySmall(chunk);
+    bool is_top = magnitude.IsZero();
+    for (int j = 0; j < chunk_digits; ++j) {
+      if (is_top && remainder == 0 && first != begin) {
+        break;
+      }
+      if (first == last) {
+        return {last, std::errc::value_too_large};
+      }
+      *first++ = "0123456789abcdefghijklmnopqrstuvwxyz"[remainder % base];
+      remainder /= base;
+    }
+  } while (!magnitude.IsZero());
+  std::reverse(begin, first);
+  return {first, std::errc()};
+}
+
+std::from_chars_result BigInteger::FromChars(const char* first,
+                                             const char* last, int base) {
+  return FromCharsImpl(first, last, base, nullptr);
+}
+std::from_chars_result BigInteger::FromChars(const char* first,
+                                             const char* last, int base,
+                                             const OperationControl& control) {
+  std::from_chars_result result = FromCharsImpl(first, last, base, &control);
+  control.ReportProgress(1.0);
+  return result;
+}
+std::from_chars_result BigInteger::FromCharsImpl(
+    const char* first, const char* last, int base,
+    const OperationControl* control) {
+  NENIY_STATS_SCOPE(kParse, (last - first) / cBlockSize + 1);
+  ProgressTracker progress(control);
+  if (base < 2 || base > 36) {
+    throw std::invalid_argument("Base must be in [2, 36].");
+  }
+  const char* digits = first;
+  bool negative = digits != last && *digits == '-';
+  if (negative) {
+    ++digits;
+  }
+  const char* end = digits;
+  while (end != last && DigitValue(*end) < base) {
+    ++end;
+  }
+  if (end == digits) {
+    return {first, std::errc::invalid_argument};
+  }
+
+  BigInteger result;
+  if (base == 10) {  // Считывание по 9 цифр блоками с конца строки
+    result.blocks_.clear();
+    const char* block_end = end;
+    while (block_end != digits) {
+      const char* block_begin =
+          block_end - std::min<ptrdiff_t>(cBlockSize, block_end - digits);
+      BlockT block = 0;
+      for (const char* it = block_begin; it != block_end; ++it) {
+        block = block * 10 + (*it - '0');
+      }
+      result.blocks_.push_back(block);
+      block_end = block_begin;
+    }
+    while (result.blocks_.back() == 0 && result.blocks_.size() > 1) {
+      result.blocks_.pop_back();
+    }
+  } else {
+    int chunk_digits;
+    ChunkForBase(base, chunk_digits);
+    const char* begin = digits;
+    while (digits != end) {
+      progress.Checkpoint(digits - begin, end - begin);
+      BlockT multiplier = 1;
+      BlockT value = 0;
+      for (int j = 0; j < chunk_digits && digits != end; ++j, ++digits) {
+        value = value * base + DigitValue(*digits);
+        multiplier *= base;
+      }
+      result.MultiplyAddSmall(multiplier, value);
+    }
+  }
+  result.is_negative_ = negative && !result.IsZero();
+  *this = std::move(result);
+  return {end, std::errc()};
+}
+
+size_t BigInteger::SerializedSize() const {
+  EnsureDecimal();
+  return cSerialHeaderSize + blocks_.size() * sizeof(uint32_t);
+}
+
+size_t BigInteger::Serialize(unsigned char* buffer, size_t size) const {
+  EnsureDecimal();
+  if (blocks_.size() > UINT32_MAX) {  // Не влезает в поле длины
+    throw std::length_error("BigInteger is too large to serialize.");
+  }
+  size_t needed = SerializedSize();
+  if (size < needed) {
+    throw std::length_error("Serialization buffer is too small.");
+  }
+  buffer[0] = cSerialVersion;
+  buffer[1] = is_negative_ ? 1 : 0;
+  buffer[2] = 0;
+  buffer[3] = 0;
+  WriteU32(buffer + 4, blocks_.size());
+  unsigned char* dest = buffer + cSerialHeaderSize;
+  for (BlockT block : blocks_) {
+    WriteU32(dest, block);
+    dest += sizeof(uint32_t);
+  }
+  return needed;
+}
+
 BigInteger& BigInteger::operator+=(const BigInteger& rhs) {
+  NENIY_STATS_SCOPE(kAdd, std::max(LimbCount(), rhs.LimbCount()));
+  MakeDecimal();
+  rhs.EnsureDecimal();
   if (!is_negative_ && rhs.is_negative_) {  // lhs + (-rhs) = lhs - rhs
     *this -= -rhs;
   } else if (is_negative_ && !rhs.is_negative_) {  // -lhs + rhs = rhs - lhs
@@ -267,6 +724,9 @@ BigInteger& BigInteger::operator+=(const BigInteger& rhs) {
   return *this;
 }
 BigInteger& BigInteger::operator-=(const BigInteger& rhs) {
+  NENIY_STATS_SCOPE(kSubtract, std::max(LimbCount(), rhs.LimbCount()));
+  MakeDecimal();
+  rhs.EnsureDecimal();
   if (!is_negative_ && rhs.is_negative_) {  // lhs-(-rhs) = lhs + rhs
     *this += -rhs;
   } else if (is_negative_ && !rhs.is_negative_) {  // -lhs - rhs = -(lhs + rhs)
@@ -311,15 +771,24 @@ BigInteger& BigInteger::operator-=(const BigInteger& rhs) {
   return *this;
 }
 BigInteger& BigInteger::operator*=(const BigInteger& rhs) {
+  return MultiplyAssign(rhs, nullptr);
+}
+BigInteger& BigInteger::MultiplyAssign(const BigInteger& rhs,
+                                       const OperationControl* control) {
+  NENIY_STATS_SCOPE(kMultiply, std::max(LimbCount(), rhs.LimbCount()));
+  ProgressTracker progress(control);
+  MakeDecimal();
+  rhs.EnsureDecimal();
   if (IsZero() || rhs.IsZero()) {
     *this = 0;
   } else {
     is_negative_ = is_negative_ != rhs.is_negative_;
     int sz = blocks_.size();
     int rhs_sz = rhs.blocks_.size();
-    std::vector<BlockT> new_blocks(sz + rhs_sz);
+    BlockVector new_blocks(sz + rhs_sz);
 
     for (int i = 0; i < rhs_sz; ++i) {  // Умножение "в столбик"
+      progress.Checkpoint(i, rhs_sz);
       int carry = 0;
       for (int j = 0; j < sz || carry != 0; ++j) {
         long long rhs_block = rhs.blocks_[i];
@@ -345,6 +814,122 @@ BigInteger& BigInteger::operator%=(const BigInteger& rhs) {
   return *this;
 }
 
+BigInteger BigInteger::Multiply(const BigInteger& rhs,
+                                const OperationControl& control) const {
+  BigInteger product = *this;
+  product.MultiplyAssign(rhs, &control);
+  control.ReportProgress(1.0);
+  return product;
+}
+std::pair<BigInteger, BigInteger> BigInteger::DivideWithRemainder(
+    const BigInteger& rhs, const OperationControl& control) const {
+  std::pair<BigInteger, BigInteger> result = DivMod(rhs, &control);
+  control.ReportProgress(1.0);
+  return result;
+}
+
+BigInteger& BigInteger::operator&=(const BigInteger& rhs) {
+  NENIY_STATS_SCOPE(kBitwise, std::max(LimbCount(), rhs.LimbCount()));
+  auto op = [](uint32_t lhs, uint32_t rhs) { return lhs & rhs; };
+  if (!PreferLowBlocks(rhs)) {
+    *this = BitwiseOp(*this, rhs, op);
+  } else if (!rhs.is_negative_) {
+    // Результат с неотрицательным операндом из m блоков меньше 2^(30m) и
+    // зависит только от младших блоков второго операнда
+    *this = BitwiseOp(LowBlocks(BlocksForBits(rhs.blocks_.size() * 30)), rhs,
+                      op);
+  } else {
+    *this = BitwiseOp(*this,
+                      rhs.LowBlocks(BlocksForBits(blocks_.size() * 30)), op);
+  }
+  return *this;
+}
+BigInteger& BigInteger::operator|=(const BigInteger& rhs) {
+  NENIY_STATS_SCOPE(kBitwise, std::max(LimbCount(), rhs.LimbCount()));
+  if (PreferLowBlocks(rhs)) {  // x | m == x + m - (x & m)
+    BigInteger common = *this & rhs;
+    *this += rhs;
+    *this -= common;
+    return *this;
+  }
+  *this = BitwiseOp(*this, rhs,
+                    [](uint32_t lhs, uint32_t rhs) { return lhs | rhs; });
+  return *this;
+}
+BigInteger& BigInteger::operator^=(const BigInteger& rhs) {
+  NENIY_STATS_SCOPE(kBitwise, std::max(LimbCount(), rhs.LimbCount()));
+  if (PreferLowBlocks(rhs)) {  // x ^ m == x + m - 2 (x & m)
+    BigInteger common = *this & rhs;
+    *this += rhs;
+    *this -= common;
+    *this -= common;
+    return *this;
+  }
+  *this = BitwiseOp(*this, rhs,
+                    [](uint32_t lhs, uint32_t rhs) { return lhs ^ rhs; });
+  return *this;
+}
+BigInteger& BigInteger::operator<<=(size_t shift) {
+  NENIY_STATS_SCOPE(kShift, LimbCount());
+  if (IsZero()) {
+    return *this;
+  }
+  // Знак не меняется, сдвигается только модуль
+  MakeBinary();
+  size_t bit_shift = shift % 32;
+  if (bit_shift != 0) {
+    uint32_t carry = 0;
+    for (uint32_t& word : words_) {
+      uint32_t next_carry = word >> (32 - bit_shift);
+      word = (word << bit_shift) | carry;
+      carry = next_carry;
+    }
+    if (carry != 0) {
+      words_.push_back(carry);
+    }
+  }
+  words_.insert(words_.begin(), shift / 32, 0);
+  return *this;
+}
+BigInteger& BigInteger::operator>>=(size_t shift) {
+  NENIY_STATS_SCOPE(kShift, LimbCount());
+  if (IsZero()) {
+    return *this;
+  }
+  MakeBinary();
+  size_t word_shift = shift / 32;
+  size_t bit_shift = shift % 32;
+  // Для отрицательных: x >> k == -ceil(|x| / 2^k), то есть к модулю
+  // прибавляется 1, если отброшен хотя бы один единичный бит
+  bool dropped_one = false;
+  if (word_shift >= words_.size()) {
+    dropped_one = true;
+    words_.clear();
+  } else {
+    for (size_t i = 0; i < word_shift; ++i) {
+      dropped_one = dropped_one || words_[i] != 0;
+    }
+    words_.erase(words_.begin(), words_.begin() + word_shift);
+    if (bit_shift != 0) {
+      dropped_one = dropped_one ||
+                    (words_[0] & ((uint32_t{1} << bit_shift) - 1)) != 0;
+      size_t sz = words_.size();
+      for (size_t i = 0; i < sz; ++i) {
+        uint32_t high = i + 1 < sz ? words_[i + 1] << (32 - bit_shift) : 0;
+        words_[i] = (words_[i] >> bit_shift) | high;
+      }
+      TrimWords(words_);
+    }
+  }
+  if (is_negative_ && dropped_one) {
+    IncrementWords(words_);
+  }
+  if (words_.empty()) {
+    is_negative_ = false;
+  }
+  return *this;
+}
+
 BigInteger BigInteger::operator-() const {
   if (IsZero()) {
     return 0;
@@ -354,8 +939,18 @@ BigInteger BigInteger::operator-() const {
   new_bigint.is_negative_ ^= 1;
   return new_bigint;
 }
+BigInteger BigInteger::operator~() const {  // ~x == -x - 1
+  BigInteger inverted = -*this;
+  --inverted;
+  return inverted;
+}
 
-void BigInteger::IncrementLogic() {
+void BigInteger::IncrementLogic() {  // Модуль увеличивается на 1 в любой форме
+  if (!HasForm(kDecimalForm)) {
+    IncrementWords(words_);
+    return;
+  }
+  MakeDecimal();
   int sz = blocks_.size();
   bool carry = true;
   int i = 0;
@@ -373,16 +968,20 @@ void BigInteger::IncrementLogic() {
   }
 }
 BigInteger& BigInteger::operator++() {
-  if (is_negative_ && blocks_.size() == 1 && blocks_[0] == 1) {
-    *this = 0;
-  } else if (is_negative_) {
+  if (is_negative_) {
     DecrementLogic();
+    is_negative_ = !IsZero();
   } else {
     IncrementLogic();
   }
   return *this;
 }
 void BigInteger::DecrementLogic() {
+  if (!HasForm(kDecimalForm)) {
+    DecrementWords(words_);
+    return;
+  }
+  MakeDecimal();
   int i = 0;
   --blocks_[i];
   while (blocks_[i] < 0) {  // decrementLogic никогда не вызывается с 0
@@ -396,10 +995,14 @@ void BigInteger::DecrementLogic() {
 }
 
 std::pair<BigInteger, BigInteger> BigInteger::DivMod(
-    const BigInteger& rhs) const {
+    const BigInteger& rhs, const OperationControl* control) const {
+  NENIY_STATS_SCOPE(kDivMod, std::max(LimbCount(), rhs.LimbCount()));
+  ProgressTracker progress(control);
   if (rhs.IsZero()) {
     throw std::runtime_error("Division by zero.");
   }
+  EnsureDecimal();
+  rhs.EnsureDecimal();
 
   BigInteger divisor = rhs;
   divisor.is_negative_ = false;
@@ -411,6 +1014,7 @@ std::pair<BigInteger, BigInteger> BigInteger::DivMod(
 
   int sz = blocks_.size();
   for (int i = sz - 1; i >= 0; --i) {
+    progress.Checkpoint(sz - 1 - i, sz);
     block.blocks_.insert(block.blocks_.begin(), blocks_[i]);
     if (block < divisor) {
       result.blocks_.insert(result.blocks_.begin(), 0);
@@ -452,6 +1056,288 @@ std::pair<BigInteger, BigInteger> BigInteger::DivMod(
   return {result, block};
 }
 
+BigInteger::BlockT BigInteger::DivideBySmall(BlockT divisor) {
+  MakeDecimal();
+  BlockT remainder = 0;
+  int sz = blocks_.size();
+  for (int i = sz - 1; i >= 0; --i) {
+    BlockT current = remainder * cMaxBlock + blocks_[i];
+    blocks_[i] = current / divisor;
+    remainder = current % divisor;
+  }
+  while (blocks_.back() == 0 && blocks_.size() > 1) {
+    blocks_.pop_back();
+  }
+  return remainder;
+}
+void BigInteger::MultiplyAddSmall(BlockT multiplier, BlockT addend) {
+  MakeDecimal();
+  BlockT carry = addend;
+  for (BlockT& block : blocks_) {
+    block = block * multiplier + carry;
+    carry = block / cMaxBlock;
+    block %= cMaxBlock;
+  }
+  while (carry != 0) {
+    blocks_.push_back(carry % cMaxBlock);
+    carry /= cMaxBlock;
+  }
+  while (blocks_.back() == 0 && blocks_.size() > 1) {
+    blocks_.pop_back();
+  }
+}
+
+int BigInteger::DigitValue(char digit) {
+  if (digit >= '0' && digit <= '9') {
+    return digit - '0';
+  }
+  if (digit >= 'a' && digit <= 'z') {
+    return digit - 'a' + 10;
+  }
+  if (digit >= 'A' && digit <= 'Z') {
+    return digit - 'A' + 10;
+  }
+  return 36;  // Не цифра ни в одной системе счисления
+}
+BigInteger::BlockT BigInteger::ChunkForBase(int base, int& chunk_digits) {
+  // Наибольшая степень base, не превосходящая cMaxBlock
+  BlockT chunk = base;
+  chunk_digits = 1;
+  while (chunk * base <= cMaxBlock) {
+    chunk *= base;
+    ++chunk_digits;
+  }
+  return chunk;
+}
+
+size_t BigInteger::BlocksForBits(size_t bits) {
+  // 10^9 = 2^9 * 5^9: младшие m блоков задают число по модулю 2^(9m)
+  return (bits + cBlockSize - 1) / cBlockSize;
+}
+BigInteger BigInteger::LowBlocks(size_t count) const {
+  // Сравнимо с *this по модулю 2^(9 * count), знак сохраняется
+  EnsureDecimal();
+  if (count >= blocks_.size()) {
+    return *this;
+  }
+  BigInteger prefix;
+  prefix.blocks_.assign(blocks_.begin(), blocks_.begin() + count);
+  while (prefix.blocks_.back() == 0 && prefix.blocks_.size() > 1) {
+    prefix.blocks_.pop_back();
+  }
+  prefix.is_negative_ = is_negative_ && !prefix.IsZero();
+  return prefix;
+}
+
+bool BigInteger::HasForm(Form form) const {
+  return (forms_.load(std::memory_order_acquire) & form) != 0;
+}
+void BigInteger::EnsureDecimal() const {
+  if (HasForm(kDecimalForm)) {
+    return;
+  }
+  // Перевод идёт без блокировки: слова уже готовы, и их никто не меняет
+  BlockVector blocks = WordsToBlocks(words_);
+  std::lock_guard<std::mutex> lock(FormMutex());
+  if (!HasForm(kDecimalForm)) {
+    blocks_ = std::move(blocks);
+    forms_.fetch_or(kDecimalForm, std::memory_order_release);
+  }
+}
+void BigInteger::EnsureBinary() const {
+  if (HasForm(kBinaryForm)) {
+    return;
+  }
+  WordVector words = BlocksToWords(blocks_);
+  std::lock_guard<std::mutex> lock(FormMutex());
+  if (!HasForm(kBinaryForm)) {
+    words_ = std::move(words);
+    forms_.fetch_or(kBinaryForm, std::memory_order_release);
+  }
+}
+void BigInteger::MakeDecimal() {
+  EnsureDecimal();
+  if (HasForm(kBinaryForm)) {
+    forms_.store(kDecimalForm, std::memory_order_relaxed);
+    words_.clear();
+  }
+}
+void BigInteger::MakeBinary() {
+  EnsureBinary();
+  if (HasForm(kDecimalForm)) {
+    forms_.store(kBinaryForm, std::memory_order_relaxed);
+    blocks_.clear();
+  }
+}
+size_t BigInteger::LimbCount() const {
+  return HasForm(kDecimalForm) ? blocks_.size() : words_.size();
+}
+std::mutex& BigInteger::FormMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+BigInteger::WordVector BigInteger::BlocksToWords(const BlockVector& blocks) {
+  // Схема Горнера с старших блоков: words = words * 10^9 + block, по два блока
+  // за обход, как в WordsToBlocks. Нуль — пустой вектор
+  WordVector words;
+  words.reserve(blocks.size());
+  size_t i = blocks.size();
+  if (i % 2 != 0) {
+    --i;
+    if (blocks[i] != 0) {
+      words.push_back(static_cast<uint32_t>(blocks[i]));  // Блок < 2^30
+    }
+  }
+  for (; i != 0; i -= 2) {
+    uint64_t high_carry = blocks[i - 1];
+    uint64_t low_carry = blocks[i - 2];
+    for (uint32_t& word : words) {
+      uint64_t current = uint64_t{word} * cMaxBlock + high_carry;
+      high_carry = current >> 32;
+      current = (current & UINT32_MAX) * cMaxBlock + low_carry;
+      low_carry = current >> 32;
+      word = static_cast<uint32_t>(current);
+    }
+    for (; high_carry != 0; high_carry >>= 32) {
+      uint64_t current = (high_carry & UINT32_MAX) * cMaxBlock + low_carry;
+      low_carry = current >> 32;
+      words.push_back(static_cast<uint32_t>(current));
+    }
+    for (; low_carry != 0; low_carry >>= 32) {
+      words.push_back(static_cast<uint32_t>(low_carry));
+    }
+  }
+  TrimWords(words);
+  return words;
+}
+BigInteger::BlockVector BigInteger::WordsToBlocks(const WordVector& words) {
+  // Та же схема в обратную сторону: blocks = blocks * 2^32 + word. Слова
+  // берутся парами за один обход, чтобы две цепочки переносов шли параллельно
+  BlockVector blocks;
+  blocks.reserve(words.size() * 32 / 29 + 1);
+  size_t i = words.size();
+  if (i % 2 != 0) {  // Старшее слово без пары
+    --i;
+    for (uint64_t carry = words[i]; carry != 0; carry /= cMaxBlock) {
+      blocks.push_back(static_cast<BlockT>(carry % cMaxBlock));
+    }
+  }
+  for (; i != 0; i -= 2) {
+    uint64_t high_carry = words[i - 1];
+    uint64_t low_carry = words[i - 2];
+    for (BlockT& block : blocks) {
+      uint64_t current = (static_cast<uint64_t>(block) << 32) + high_carry;
+      high_carry = current / cMaxBlock;
+      current = ((current % cMaxBlock) << 32) + low_carry;
+      low_carry = current / cMaxBlock;
+      block = static_cast<BlockT>(current % cMaxBlock);
+    }
+    // Новые блоки первого прохода тоже проходят через второй
+    for (; high_carry != 0; high_carry /= cMaxBlock) {
+      uint64_t current = ((high_carry % cMaxBlock) << 32) + low_carry;
+      low_carry = current / cMaxBlock;
+      blocks.push_back(static_cast<BlockT>(current % cMaxBlock));
+    }
+    for (; low_carry != 0; low_carry /= cMaxBlock) {
+      blocks.push_back(static_cast<BlockT>(low_carry % cMaxBlock));
+    }
+  }
+  if (blocks.empty()) {
+    blocks.push_back(0);
+  }
+  return blocks;
+}
+void BigInteger::IncrementWords(WordVector& words) {
+  for (uint32_t& word : words) {
+    if (++word != 0) {
+      return;
+    }
+  }
+  words.push_back(1);
+}
+void BigInteger::DecrementWords(WordVector& words) {  // Только для words != 0
+  for (uint32_t& word : words) {
+    if (word-- != 0) {
+      break;
+    }
+  }
+  TrimWords(words);
+}
+void BigInteger::TrimWords(WordVector& words) {
+  while (!words.empty() && words.back() == 0) {
+    words.pop_back();
+  }
+}
+size_t BigInteger::WordsTrailingZeroBits(const WordVector& words) {
+  size_t zeros = 0;
+  size_t i = 0;
+  for (; words[i] == 0; ++i) {  // Для ненулевого числа
+    zeros += 32;
+  }
+  return zeros + std::countr_zero(words[i]);
+}
+BigInteger BigInteger::FromWords(WordVector words, bool negative) {
+  TrimWords(words);
+  BigInteger result;
+  result.is_negative_ = negative && !words.empty();
+  result.words_ = std::move(words);
+  result.blocks_.clear();
+  result.forms_.store(kBinaryForm, std::memory_order_relaxed);
+  return result;
+}
+
+BigInteger::WordVector BigInteger::TwosComplementWords() const {
+  EnsureBinary();
+  WordVector words = words_;
+  if (is_negative_) {  // Отрицательное x == ~(|x| - 1), старшие биты — единицы
+    DecrementWords(words);
+    for (uint32_t& word : words) {
+      word = ~word;
+    }
+  }
+  return words;
+}
+
+bool BigInteger::PreferLowBlocks(const BigInteger& rhs) const {
+  // Младшие блоки выгоднее перевода в двоичную форму, только если переводить
+  // пришлось бы длинный операнд, а для & нужен неотрицательный операнд
+  return HasForm(kDecimalForm) && rhs.HasForm(kDecimalForm) &&
+         !(HasForm(kBinaryForm) && rhs.HasForm(kBinaryForm)) &&
+         (!is_negative_ || !rhs.is_negative_);
+}
+
+template <typename Op>
+BigInteger BigInteger::BitwiseOp(const BigInteger& lhs, const BigInteger& rhs,
+                                 Op op) {
+  WordVector lhs_words = lhs.TwosComplementWords();
+  WordVector rhs_words = rhs.TwosComplementWords();
+  uint32_t lhs_fill = lhs.is_negative_ ? UINT32_MAX : 0;
+  uint32_t rhs_fill = rhs.is_negative_ ? UINT32_MAX : 0;
+
+  size_t sz = std::max(lhs_words.size(), rhs_words.size());
+  WordVector words(sz);
+  for (size_t i = 0; i < sz; ++i) {
+    words[i] = op(i < lhs_words.size() ? lhs_words[i] : lhs_fill,
+                  i < rhs_words.size() ? rhs_words[i] : rhs_fill);
+  }
+  bool negative = op(lhs_fill, rhs_fill) != 0;
+  if (negative) {  // Обратный переход: |x| == ~words + 1
+    for (uint32_t& word : words) {
+      word = ~word;
+    }
+    TrimWords(words);
+    IncrementWords(words);
+  }
+  return FromWords(std::move(words), negative);
+}
+
+void BigInteger::WriteU32(unsigned char* dest, uint32_t value) {
+  for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+    dest[i] = static_cast<unsigned char>(value >> (8 * i));
+  }
+}
+
 BigInteger& BigInteger::operator--() {
   if (IsZero()) {
     *this = -1;
@@ -483,11 +1369,131 @@ void BigInteger::FlipSign() {
 }
 
 bool BigInteger::IsZero() const {
+  if (!HasForm(kDecimalForm)) {
+    return words_.empty();
+  }
   return blocks_.size() == 1 && blocks_[0] == 0;
 }
 bool BigInteger::IsNegative() const { return is_negative_; }
-const std::vector<BigInteger::BlockT>& BigInteger::GetBlocks() const {
+
+bool BigInteger::TestBit(size_t index) const {
+  if (HasForm(kBinaryForm)) {
+    size_t word = index / 32;
+    bool bit = word < words_.size() && ((words_[word] >> (index % 32)) & 1U);
+    if (!is_negative_) {
+      return bit;
+    }
+    // В ~(|x| - 1) биты до младшей единицы модуля включительно совпадают с
+    // битами модуля, а старше неё инвертированы
+    size_t lowest_one = WordsTrailingZeroBits(words_);
+    return index <= lowest_one ? bit : !bit;
+  }
+  // Младшие index + 1 бит префикса совпадают с битами *this (в том числе для
+  // отрицательных: -префикс сравнимо с -|x| по модулю 2^(index + 1))
+  BigInteger prefix = LowBlocks(BlocksForBits(index + 1));
+  prefix.EnsureBinary();  // Префикс из O(index) бит переводится целиком
+  return prefix.TestBit(index);
+}
+size_t BigInteger::BitLength() const {
+  if (IsZero()) {
+    return 0;
+  }
+  if (HasForm(kBinaryForm)) {
+    return words_.size() * 32 - std::countl_zero(words_.back());
+  }
+  // log2 по трём старшим блокам; ошибка оценки много меньше 1e-6
+  int sz = blocks_.size();
+  int top = std::min(sz, 3);
+  long double head = 0;
+  for (int i = sz - 1; i >= sz - top; --i) {
+    head = head * cMaxBlock + blocks_[i];
+  }
+  long double log2 = std::log2(head) + static_cast<long double>(sz - top) *
+                                           cBlockSize * std::log2(10.0L);
+  long double floor_log2 = std::floor(log2);
+  if (log2 - floor_log2 > 1e-6L && floor_log2 + 1 - log2 > 1e-6L) {
+    return static_cast<size_t>(floor_log2) + 1;
+  }
+  EnsureBinary();  // Остаётся у числа, повторный вызов уже O(1)
+  return words_.size() * 32 - std::countl_zero(words_.back());
+}
+size_t BigInteger::PopCount() const {
+  EnsureBinary();
+  size_t count = 0;
+  for (uint32_t word : words_) {
+    count += std::popcount(word);
+  }
+  return count;
+}
+size_t BigInteger::TrailingZeroBits() const {
+  if (IsZero()) {
+    return 0;
+  }
+  if (HasForm(kBinaryForm)) {
+    return WordsTrailingZeroBits(words_);
+  }
+  // Если у префикса меньше bits нулей, у *this их столько же; иначе префикс
+  // удваивается
+  for (size_t bits = 64;; bits *= 2) {
+    size_t count = BlocksForBits(bits);
+    BigInteger prefix = LowBlocks(count);
+    if (prefix.IsZero()) {
+      continue;
+    }
+    prefix.EnsureBinary();
+    size_t zeros = WordsTrailingZeroBits(prefix.words_);
+    if (zeros < bits || count >= blocks_.size()) {
+      return zeros;
+    }
+  }
+}
+const BigInteger::BlockVector& BigInteger::GetBlocks() const {
+  EnsureDecimal();
   return blocks_;
 }
 
+BigIntegerView::BigIntegerView(const unsigned char* data, size_t size)
+    : data_(data), block_count_(0) {
+  if (size < BigInteger::cSerialHeaderSize ||
+      data[0] != BigInteger::cSerialVersion || data[1] > 1 || data[2] != 0 ||
+      data[3] != 0) {
+    throw std::runtime_error("Malformed BigInteger serialization.");
+  }
+  block_count_ = ReadU32(data + 4);
+  if (block_count_ == 0 ||
+      (size - BigInteger::cSerialHeaderSize) / sizeof(uint32_t) <
+          block_count_ ||
+      (block_count_ > 1 && GetBlock(block_count_ - 1) == 0) ||
+      (IsNegative() && IsZero())) {  // Только нормализованные числа
+    throw std::runtime_error("Malformed BigInteger serialization.");
+  }
+  // Один проход по блокам без копирования: дальше GetBlock всегда < cMaxBlock
+  for (size_t i = 0; i < block_count_; ++i) {
+    if (GetBlock(i) >= BigInteger::cMaxBlock) {
+      throw std::runtime_error("Malformed BigInteger serialization.");
+    }
+  }
+}
+
+bool BigIntegerView::IsNegative() const { return data_[1] != 0; }
+bool BigIntegerView::IsZero() const {
+  return block_count_ == 1 && GetBlock(0) == 0;
+}
+size_t BigIntegerView::BlockCount() const { return block_count_; }
+BigInteger::BlockT BigIntegerView::GetBlock(size_t index) const {
+  return ReadU32(data_ + BigInteger::cSerialHeaderSize +
+                 index * sizeof(uint32_t));
+}
+size_t BigIntegerView::ByteSize() const {
+  return BigInteger::cSerialHeaderSize + block_count_ * sizeof(uint32_t);
+}
+
+uint32_t BigIntegerView::ReadU32(const unsigned char* src) {
+  uint32_t value = 0;
+  for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+    value |= static_cast<uint32_t>(src[i]) << (8 * i);
+  }
+  return value;
+}
+
 #endif // NENIY_BIGINTEGER
@@ -0,0 +1,104 @@
+#pragma once
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "BigInteger.h"
+#include "OperationControl.h"
+#include "Rational.h"
+
+#ifndef NENIY_BIGINTEGER_ASYNC
+#define NENIY_BIGINTEGER_ASYNC
+
+// Асинхронные варианты долгих операций. Задача отдаётся исполнителю, результат
+// (или исключение, в том числе OperationCancelled) приходит через std::future.
+// Отмена и прогресс — через OperationControl.
+
+// Исполнитель принимает задачу и должен когда-нибудь её запустить, например
+// в пуле потоков сервиса; дождаться задач, в том числе брошенных после
+// отмены, должен он сам (пул, который при остановке делает join).
+// Пустой исполнитель (по умолчанию) запускает задачу как
+// std::async(std::launch::async): деструктор future ждёт её завершения, так
+// что задача не переживает вызывающего, даже если future брошен
+using Executor = std::function<void(std::function<void()> /*task*/)>;
+
+template <typename Body>
+auto RunAsync(const Executor& executor, Body body)
+    -> std::future<decltype(body())> {
+  using ResultT = decltype(body());
+  if (!executor) {
+    return std::async(std::launch::async, std::move(body));
+  }
+  // std::function требует копируемости, поэтому promise лежит в shared_ptr
+  auto promise = std::make_shared<std::promise<ResultT>>();
+  std::future<ResultT> future = promise->get_future();
+  executor([promise, body = std::move(body)]() mutable {
+    try {
+      promise->set_value(body());
+    } catch (...) {
+      promise->set_exception(std::current_exception());
+    }
+  });
+  return future;
+}
+
+std::future<BigInteger> MultiplyAsync(
+    BigInteger lhs, BigInteger rhs, OperationControl control = {},
+    const Executor& executor = {}) {
+  return RunAsync(executor, [lhs = std::move(lhs), rhs = std::move(rhs),
+                             control = std::move(control)] {
+    return lhs.Multiply(rhs, control);
+  });
+}
+
+std::future<std::pair<BigInteger, BigInteger>> DivModAsync(
+    BigInteger lhs, BigInteger rhs, OperationControl control = {},
+    const Executor& executor = {}) {
+  return RunAsync(executor, [lhs = std::move(lhs), rhs = std::move(rhs),
+                             control = std::move(control)] {
+    return lhs.DivideWithRemainder(rhs, control);
+  });
+}
+
+std::future<std::string> ToStringAsync(
+    BigInteger value, int base = 10, OperationControl control = {},
+    const Executor& executor = {}) {
+  return RunAsync(executor, [value = std::move(value), base,
+                             control = std::move(control)] {
+    // Блок < 2^30, так что цифр не больше 30 на блок (для основания 2) и знака
+    std::string str(value.GetBlocks().size() * 30 + 1, '\0');
+    auto result = value.ToChars(str.data(), str.data() + str.size(), base,
+                                control);
+    str.resize(result.ptr - str.data());
+    return str;
+  });
+}
+
+// Разбор строки целиком; на некорректной строке future бросает
+// std::invalid_argument
+std::future<BigInteger> FromStringAsync(std::string str, int base = 10,
+                                        OperationControl control = {},
+                                        const Executor& executor = {}) {
+  return RunAsync(executor, [str = std::move(str), base,
+                             control = std::move(control)] {
+    BigInteger value;
+    auto result =
+        value.FromChars(str.data(), str.data() + str.size(), base, control);
+    if (result.ec != std::errc() || result.ptr != str.data() + str.size()) {
+      throw std::invalid_argument("Malformed BigInteger string.");
+    }
+    return value;
+  });
+}
+
+std::future<std::string> AsDecimalAsync(
+    Rational value, size_t precision, OperationControl control = {},
+    const Executor& executor = {}) {
+  return RunAsync(executor, [value = std::move(value), precision,
+                             control = std::move(control)] {
+    return value.asDecimal(precision, control);
+  });
+}
+
+#endif // NENIY_BIGINTEGER_ASYNC
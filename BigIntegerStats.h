@@ -0,0 +1,238 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#ifndef NENIY_BIGINTEGER_STATS_H
+#define NENIY_BIGINTEGER_STATS_H
+
+// Инструментирование включается флагом компиляции NENIY_BIGINTEGER_STATS.
+// Без него NENIY_STATS_SCOPE раскрывается в пустоту, а BigInteger хранит блоки
+// в обычном std::vector, так что накладных расходов нет.
+#ifdef NENIY_BIGINTEGER_STATS
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <memory>
+
+class BigIntegerStats {
+ public:
+  // calls, время и выделения памяти относятся к внешней операции потока:
+  // умножения внутри DivMod или деления внутри Rational::operator+= входят
+  // в её время и выделения. Вложенные вызовы видны только в inclusive_calls,
+  // где считаются все вызовы операции, внешние и вложенные
+  enum Operation {
+    kAdd,
+    kSubtract,
+    kMultiply,
+    kDivMod,
+    kToString,
+    kParse,
+    kBitwise,
+    kShift,
+    kRationalAdd,
+    kRationalSubtract,
+    kRationalMultiply,
+    kRationalDivide,
+    kRationalSimplify,
+    kRationalAsDecimal,
+    kRationalToDouble,
+    kOperationCount
+  };
+
+  // Корзина i — операнды размером из [2^(i-1), 2^i) блоков
+  static const int cHistogramBuckets = 32;
+
+  struct OperationStats {
+    uint64_t calls = 0;
+    uint64_t inclusive_calls = 0;
+    uint64_t nanoseconds = 0;
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+    uint64_t size_histogram[cHistogramBuckets] = {};
+  };
+
+  struct Snapshot {
+    OperationStats operations[kOperationCount];
+    uint64_t allocations = 0;  // Все выделения, в том числе вне операций
+    uint64_t allocated_bytes = 0;
+  };
+
+  class Scope {
+   public:
+    Scope(Operation /*operation*/, size_t /*operand_blocks*/);
+
+    Scope(const Scope&) = delete;
+
+    Scope& operator=(const Scope&) = delete;
+
+    ~Scope();
+
+   private:
+    friend class BigIntegerStats;
+
+    // Внешняя операция текущего потока (kOperationCount вне операций) и
+    // глубина вложенности Scope
+    struct ThreadState {
+      Operation outermost = kOperationCount;
+      int depth = 0;
+    };
+
+    static ThreadState& CurrentThread();
+
+    Operation operation_;
+    bool is_outermost_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  // Аллокатор для блоков BigInteger, считающий выделения памяти
+  template <typename T>
+  struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& /*other*/) {}
+
+    T* allocate(size_t count) {
+      RecordAllocation(count * sizeof(T));
+      return std::allocator<T>().allocate(count);
+    }
+
+    void deallocate(T* ptr, size_t count) {
+      std::allocator<T>().deallocate(ptr, count);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>& /*other*/) const {
+      return true;
+    }
+  };
+
+  static Snapshot TakeSnapshot();
+
+  static void Reset();
+
+  static void RecordAllocation(size_t /*bytes*/);
+
+ private:
+  struct Counters {
+    std::atomic<uint64_t> calls[kOperationCount];
+    std::atomic<uint64_t> inclusive_calls[kOperationCount];
+    std::atomic<uint64_t> nanoseconds[kOperationCount];
+    std::atomic<uint64_t> allocations[kOperationCount];
+    std::atomic<uint64_t> allocated_bytes[kOperationCount];
+    std::atomic<uint64_t> size_histogram[kOperationCount][cHistogramBuckets];
+    std::atomic<uint64_t> total_allocations;
+    std::atomic<uint64_t> total_allocated_bytes;
+  };
+
+  static Counters& GetCounters();
+};
+
+#define NENIY_STATS_SCOPE(operation, operand_blocks) \
+  BigIntegerStats::Scope neniy_stats_scope(BigIntegerStats::operation, \
+                                           (operand_blocks))
+
+BigIntegerStats::Scope::Scope(Operation operation, size_t operand_blocks)
+    : operation_(operation), is_outermost_(CurrentThread().depth++ == 0) {
+  Counters& counters = GetCounters();
+  counters.inclusive_calls[operation].fetch_add(1, std::memory_order_relaxed);
+  if (!is_outermost_) {
+    return;
+  }
+  CurrentThread().outermost = operation;
+  start_ = std::chrono::steady_clock::now();
+  int bucket = std::bit_width(operand_blocks);
+  if (bucket >= cHistogramBuckets) {
+    bucket = cHistogramBuckets - 1;
+  }
+  counters.calls[operation].fetch_add(1, std::memory_order_relaxed);
+  counters.size_histogram[operation][bucket].fetch_add(
+      1, std::memory_order_relaxed);
+}
+BigIntegerStats::Scope::~Scope() {
+  ThreadState& state = CurrentThread();
+  --state.depth;
+  if (!is_outermost_) {
+    return;
+  }
+  state.outermost = kOperationCount;
+  auto elapsed = std::chrono::steady_clock::now() - start_;
+  GetCounters().nanoseconds[operation_].fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+      std::memory_order_relaxed);
+}
+
+BigIntegerStats::Scope::ThreadState& BigIntegerStats::Scope::CurrentThread() {
+  thread_local ThreadState state;
+  return state;
+}
+
+BigIntegerStats::Snapshot BigIntegerStats::TakeSnapshot() {
+  Counters& counters = GetCounters();
+  Snapshot snapshot;
+  for (int i = 0; i < kOperationCount; ++i) {
+    snapshot.operations[i].calls =
+        counters.calls[i].load(std::memory_order_relaxed);
+    snapshot.operations[i].inclusive_calls =
+        counters.inclusive_calls[i].load(std::memory_order_relaxed);
+    snapshot.operations[i].nanoseconds =
+        counters.nanoseconds[i].load(std::memory_order_relaxed);
+    snapshot.operations[i].allocations =
+        counters.allocations[i].load(std::memory_order_relaxed);
+    snapshot.operations[i].allocated_bytes =
+        counters.allocated_bytes[i].load(std::memory_order_relaxed);
+    for (int j = 0; j < cHistogramBuckets; ++j) {
+      snapshot.operations[i].size_histogram[j] =
+          counters.size_histogram[i][j].load(std::memory_order_relaxed);
+    }
+  }
+  snapshot.allocations =
+      counters.total_allocations.load(std::memory_order_relaxed);
+  snapshot.allocated_bytes =
+      counters.total_allocated_bytes.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+void BigIntegerStats::Reset() {
+  Counters& counters = GetCounters();
+  for (int i = 0; i < kOperationCount; ++i) {
+    counters.calls[i].store(0, std::memory_order_relaxed);
+    counters.inclusive_calls[i].store(0, std::memory_order_relaxed);
+    counters.nanoseconds[i].store(0, std::memory_order_relaxed);
+    counters.allocations[i].store(0, std::memory_order_relaxed);
+    counters.allocated_bytes[i].store(0, std::memory_order_relaxed);
+    for (int j = 0; j < cHistogramBuckets; ++j) {
+      counters.size_histogram[i][j].store(0, std::memory_order_relaxed);
+    }
+  }
+  counters.total_allocations.store(0, std::memory_order_relaxed);
+  counters.total_allocated_bytes.store(0, std::memory_order_relaxed);
+}
+
+void BigIntegerStats::RecordAllocation(size_t bytes) {
+  Counters& counters = GetCounters();
+  counters.total_allocations.fetch_add(1, std::memory_order_relaxed);
+  counters.total_allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+  Operation operation = Scope::CurrentThread().outermost;
+  if (operation != kOperationCount) {
+    counters.allocations[operation].fetch_add(1, std::memory_order_relaxed);
+    counters.allocated_bytes[operation].fetch_add(bytes,
+                                                  std::memory_order_relaxed);
+  }
+}
+
+BigIntegerStats::Counters& BigIntegerStats::GetCounters() {
+  static Counters counters;  // std::atomic инициализируется нулём (C++20)
+  return counters;
+}
+
+#else
+
+#define NENIY_STATS_SCOPE(operation, operand_blocks)
+
+#endif // NENIY_BIGINTEGER_STATS
+
+#endif // NENIY_BIGINTEGER_STATS_H
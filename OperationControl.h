@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+#ifndef NENIY_OPERATION_CONTROL
+#define NENIY_OPERATION_CONTROL
+
+// Бросается из Checkpoint, если операция отменена или истёк срок
+class OperationCancelled : public std::runtime_error {
+ public:
+  OperationCancelled() : std::runtime_error("Operation cancelled.") {}
+};
+
+// Копии токена разделяют одно состояние: Cancel() из любого потока виден всем
+class CancellationToken {
+ public:
+  CancellationToken();
+
+  void Cancel() const;
+
+  bool IsCancelled() const;
+
+ private:
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+// Передаётся в долгие операции (умножение, деление, перевод в другую систему
+// счисления, Rational::asDecimal). Сам контроль не меняется во время операции,
+// поэтому один объект можно передавать в несколько операций, в том числе
+// из разных потоков; функция прогресса тогда должна быть потокобезопасной.
+class OperationControl {
+ public:
+  using ProgressCallback = std::function<void(double /*fraction*/)>;
+  using Clock = std::chrono::steady_clock;
+
+  OperationControl(CancellationToken /*token*/ = {},
+                   ProgressCallback /*progress*/ = {});
+
+  void SetDeadline(Clock::time_point /*deadline*/);
+
+  void ThrowIfCancelled() const;
+
+  void ReportProgress(double /*fraction*/) const;
+
+  // Тот же токен и срок без прогресса — для вложенных операций, чей прогресс
+  // не совпадает с прогрессом внешней
+  OperationControl WithoutProgress() const;
+
+ private:
+  CancellationToken token_;
+  ProgressCallback progress_;
+  Clock::time_point deadline_;
+};
+
+// Состояние одной операции: создаётся локально в её начале, проверяет отмену
+// в каждой точке и сообщает прогресс не чаще, чем раз в 1%. С nullptr ничего
+// не делает.
+class ProgressTracker {
+ public:
+  explicit ProgressTracker(const OperationControl* /*control*/);
+
+  void Checkpoint(size_t /*done*/, size_t /*total*/);
+
+ private:
+  const OperationControl* control_;
+  int last_percent_;
+};
+
+CancellationToken::CancellationToken()
+    : cancelled_(std::make_shared<std::atomic<bool>>(false)) {}
+
+void CancellationToken::Cancel() const {
+  cancelled_->store(true, std::memory_order_relaxed);
+}
+bool CancellationToken::IsCancelled() const {
+  return cancelled_->load(std::memory_order_relaxed);
+}
+
+OperationControl::OperationControl(CancellationToken token,
+                                   ProgressCallback progress)
+    : token_(std::move(token)),
+      progress_(std::move(progress)),
+      deadline_(Clock::time_point::max()) {}
+
+void OperationControl::SetDeadline(Clock::time_point deadline) {
+  deadline_ = deadline;
+}
+
+void OperationControl::ThrowIfCancelled() const {
+  if (token_.IsCancelled() ||
+      (deadline_ != Clock::time_point::max() && Clock::now() > deadline_)) {
+    throw OperationCancelled();
+  }
+}
+
+void OperationControl::ReportProgress(double fraction) const {
+  if (progress_) {
+    progress_(fraction);
+  }
+}
+
+OperationControl OperationControl::WithoutProgress() const {
+  OperationControl control(token_);
+  control.deadline_ = deadline_;
+  return control;
+}
+
+ProgressTracker::ProgressTracker(const OperationControl* control)
+    : control_(control), last_percent_(-1) {}
+
+void ProgressTracker::Checkpoint(size_t done, size_t total) {
+  if (control_ == nullptr) {
+    return;
+  }
+  control_->ThrowIfCancelled();
+  if (total == 0) {
+    return;
+  }
+  int percent = static_cast<int>(done * 100 / total);
+  if (percent > last_percent_) {
+    last_percent_ = percent;
+    control_->ReportProgress(static_cast<double>(done) / total);
+  }
+}
+
+#endif // NENIY_OPERATION_CONTROL
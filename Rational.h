@@ -1,4 +1,6 @@
 #pragma once
+#include <tuple>
+
 #include "BigInteger.h"
 
 #ifndef NENIY_RATIONAL
@@ -18,12 +20,21 @@ class Rational {
 
   Rational& operator/=(const Rational& /*rhs*/);
 
+  // Умножение и деление на 2^shift без Gcd; как и у BigInteger, сдвиг идёт по
+  // двоичной форме числителя и знаменателя за O(n + shift / 32)
+  Rational& operator<<=(size_t /*shift*/);
+
+  Rational& operator>>=(size_t /*shift*/);
+
   Rational operator-() const;
 
   std::string toString() const;
 
   std::string asDecimal(size_t /*precision*/) const;
 
+  std::string asDecimal(size_t /*precision*/,
+                        const OperationControl& /*control*/) const;
+
   bool IsNegative() const;
 
   const BigInteger& GetNumerator() const { return numerator_; }
@@ -41,6 +52,11 @@ class Rational {
 
   static void DecimalIncrementation(std::string& /*decimal*/);
 
+  size_t OperandBlocks() const;  // Для NENIY_STATS_SCOPE
+
+  std::string AsDecimalImpl(size_t /*precision*/,
+                            const OperationControl* /*control*/) const;
+
   BigInteger numerator_;
   BigInteger denominator_;
 };
@@ -84,6 +100,16 @@ Rational operator/(const Rational& lhs, const Rational& rhs) {
   quotient /= rhs;
   return quotient;
 }
+Rational operator<<(const Rational& lhs, size_t shift) {
+  Rational scaled = lhs;
+  scaled <<= shift;
+  return scaled;
+}
+Rational operator>>(const Rational& lhs, size_t shift) {
+  Rational scaled = lhs;
+  scaled >>= shift;
+  return scaled;
+}
 
 BigInteger Rational::Gcd(BigInteger a, BigInteger b) {
   if (a.IsNegative()) {
@@ -116,7 +142,13 @@ void Rational::SetNegative() {  // Починка знака (знак долж
   }
 }
 
+size_t Rational::OperandBlocks() const {
+  return std::max(numerator_.GetBlocks().size(),
+                  denominator_.GetBlocks().size());
+}
+
 void Rational::Simplify() {
+  NENIY_STATS_SCOPE(kRationalSimplify, OperandBlocks());
   auto divider = Gcd(numerator_, denominator_);
   if (divider != 1) {
     numerator_ /= divider;
@@ -159,6 +191,8 @@ Rational::Rational(const BigInteger& num, const BigInteger& denum)
 }
 
 Rational& Rational::operator+=(const Rational& rhs) {
+  NENIY_STATS_SCOPE(kRationalAdd,
+                    std::max(OperandBlocks(), rhs.OperandBlocks()));
   numerator_ = numerator_ * rhs.denominator_ + rhs.numerator_ * denominator_;
   denominator_ *= rhs.denominator_;
 
@@ -166,6 +200,8 @@ Rational& Rational::operator+=(const Rational& rhs) {
   return *this;
 }
 Rational& Rational::operator-=(const Rational& rhs) {
+  NENIY_STATS_SCOPE(kRationalSubtract,
+                    std::max(OperandBlocks(), rhs.OperandBlocks()));
   numerator_ = numerator_ * rhs.denominator_ - rhs.numerator_ * denominator_;
   denominator_ *= rhs.denominator_;
 
@@ -173,6 +209,8 @@ Rational& Rational::operator-=(const Rational& rhs) {
   return *this;
 }
 Rational& Rational::operator*=(const Rational& rhs) {
+  NENIY_STATS_SCOPE(kRationalMultiply,
+                    std::max(OperandBlocks(), rhs.OperandBlocks()));
   numerator_ *= rhs.numerator_;
   denominator_ *= rhs.denominator_;
 
@@ -180,6 +218,8 @@ Rational& Rational::operator*=(const Rational& rhs) {
   return *this;
 }
 Rational& Rational::operator/=(const Rational& rhs) {
+  NENIY_STATS_SCOPE(kRationalDivide,
+                    std::max(OperandBlocks(), rhs.OperandBlocks()));
   if (this == &rhs) {
     *this = 1;
   } else {
@@ -192,6 +232,35 @@ Rational& Rational::operator/=(const Rational& rhs) {
   return *this;
 }
 
+Rational& Rational::operator<<=(size_t shift) {
+  if (numerator_.IsZero()) {
+    return *this;
+  }
+  // Дробь несократима, поэтому достаточно сократить двойки знаменателя
+  // Нулевой сдвиг пропускается, чтобы не переводить число в двоичную форму
+  size_t cancelled = std::min(shift, denominator_.TrailingZeroBits());
+  if (cancelled != 0) {
+    denominator_ >>= cancelled;
+  }
+  if (shift != cancelled) {
+    numerator_ <<= shift - cancelled;
+  }
+  return *this;
+}
+Rational& Rational::operator>>=(size_t shift) {
+  if (numerator_.IsZero()) {
+    return *this;
+  }
+  size_t cancelled = std::min(shift, numerator_.TrailingZeroBits());
+  if (cancelled != 0) {
+    numerator_ >>= cancelled;  // Делится нацело, поэтому знак не мешает
+  }
+  if (shift != cancelled) {
+    denominator_ <<= shift - cancelled;
+  }
+  return *this;
+}
+
 Rational Rational::operator-() const {
   Rational new_rational = *this;
   new_rational.numerator_.FlipSign();
@@ -206,6 +275,17 @@ std::string Rational::toString() const {
 }
 
 std::string Rational::asDecimal(size_t precision) const {
+  return AsDecimalImpl(precision, nullptr);
+}
+std::string Rational::asDecimal(size_t precision,
+                                const OperationControl& control) const {
+  std::string decimal = AsDecimalImpl(precision, &control);
+  control.ReportProgress(1.0);
+  return decimal;
+}
+std::string Rational::AsDecimalImpl(size_t precision,
+                                    const OperationControl* control) const {
+  NENIY_STATS_SCOPE(kRationalAsDecimal, OperandBlocks());
   if (denominator_ == 1) {
     if (precision != 0) {
       return numerator_.toString() + '.' + std::string(precision, '0');
@@ -213,19 +293,30 @@ std::string Rational::asDecimal(size_t precision) const {
     return numerator_.toString();
   }
 
+  // Деления тоже проверяют отмену перед каждым блоком, но прогресс
+  // сообщается только по этапам asDecimal. Без control деления получают
+  // пустой контроль, который никогда не срабатывает
+  OperationControl division_control =
+      control != nullptr ? control->WithoutProgress() : OperationControl();
+  ProgressTracker progress(control);
+
   auto dividend = numerator_;
   if (dividend.IsNegative()) {
     dividend.FlipSign();
   }
-  auto quotient = dividend / denominator_;
+  auto [quotient, remainder] =
+      dividend.DivideWithRemainder(denominator_, division_control);
   std::string str_decimal = quotient.toString() + '.';  // целая часть
-  dividend -= quotient * denominator_;
+  dividend = std::move(remainder);
 
   int real_prec = precision / BigInteger::cBlockSize + 1;
   int to_delete = real_prec * BigInteger::cBlockSize - precision;
+  int total_prec = real_prec;
   while (real_prec != 0) {
+    progress.Checkpoint(total_prec - real_prec, total_prec);
     dividend *= BigInteger::cMaxBlock;  // Добавление нулевого блока
-    quotient = dividend / denominator_;
+    std::tie(quotient, dividend) =
+        dividend.DivideWithRemainder(denominator_, division_control);
     std::string str_quotient = quotient.toString();
     if (str_quotient.size() < BigInteger::cBlockSize) {
       str_quotient =
@@ -233,7 +324,6 @@ std::string Rational::asDecimal(size_t precision) const {
           str_quotient;
     }
     str_decimal += str_quotient;
-    dividend -= quotient * denominator_;
 
     --real_prec;
   }
@@ -254,6 +344,9 @@ std::string Rational::asDecimal(size_t precision) const {
 
 bool Rational::IsNegative() const { return numerator_.IsNegative(); }
 
-Rational::operator double() const { return std::stod(asDecimal(100)); }
+Rational::operator double() const {
+  NENIY_STATS_SCOPE(kRationalToDouble, OperandBlocks());
+  return std::stod(asDecimal(100));
+}
 
 #endif // NENIY_BIGINTEGER
@@ -0,0 +1,379 @@
+// Бенчмарки BigInteger и Rational на операндах от 1 до 10^6 цифр. Результат —
+// JSON в stdout (или в файл, --out). Входные данные генерируются с
+// фиксированным seed, так что запуски воспроизводимы.
+//
+// Параметры:
+//   --max-digits N    наибольший размер операнда (по умолчанию 1000000)
+//   --min-time S      минимальное время замера одного размера, с (0.2)
+//   --budget S        размер пропускается, если по двум предыдущим
+//                     замерам подготовка и одна итерация займут больше S
+//                     секунд (10)
+//   --out FILE        куда записать JSON
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <sstream>
+
+#include "BigInteger.h"
+#include "Rational.h"
+
+#ifdef NENIY_HAVE_GMP
+#include <gmp.h>
+#endif
+
+namespace {
+
+struct Options {
+  size_t max_digits = 1'000'000;
+  double min_time = 0.2;
+  double budget = 10;
+  std::string out;
+};
+
+struct Measurement {
+  size_t iterations = 0;
+  double seconds = 0;
+};
+
+// Экстраполирует стоимость (подготовка + итерация) на следующий размер,
+// считая рост не медленнее линейного
+class BudgetGuard {
+ public:
+  explicit BudgetGuard(double budget) : budget_(budget) {}
+
+  bool ShouldSkip() const {
+    if (last_cost_ == 0) {
+      return false;
+    }
+    double growth = previous_cost_ == 0 ? 10 : last_cost_ / previous_cost_;
+    return last_cost_ * std::max(growth, 10.0) > budget_;
+  }
+
+  void Record(double cost) {
+    previous_cost_ = last_cost_;
+    last_cost_ = cost;
+  }
+
+ private:
+  double budget_;
+  double last_cost_ = 0;
+  double previous_cost_ = 0;
+};
+
+// Операция готовит входные данные нужного размера и возвращает замеряемое тело
+using Setup = std::function<std::function<void()>(size_t /*digits*/)>;
+
+struct Benchmark {
+  std::string name;
+  Setup setup;
+  Setup gmp_setup;  // Пусто, если аналога в GMP нет (или GMP не найден)
+};
+
+size_t sink = 0;  // Не даёт компилятору выбросить результат
+
+std::string RandomDigits(size_t digits, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::string str(1, static_cast<char>('1' + rng() % 9));
+  for (size_t i = 1; i < digits; ++i) {
+    str.push_back(static_cast<char>('0' + rng() % 10));
+  }
+  return str;
+}
+
+BigInteger RandomBigInteger(size_t digits, uint64_t seed) {
+  return BigInteger(RandomDigits(digits, seed).c_str());
+}
+
+size_t HalfDigits(size_t digits) { return digits > 1 ? digits / 2 : 1; }
+
+Measurement Measure(const std::function<void()>& body, double min_time) {
+  using Clock = std::chrono::steady_clock;
+  Measurement result;
+  auto start = Clock::now();
+  do {
+    body();
+    ++result.iterations;
+    result.seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+  } while (result.seconds < min_time);
+  return result;
+}
+
+std::vector<Benchmark> MakeBenchmarks() {
+  std::vector<Benchmark> benchmarks;
+
+  auto binary = [](std::function<BigInteger(const BigInteger&,
+                                            const BigInteger&)> op,
+                   bool half_rhs) -> Setup {
+    return [op, half_rhs](size_t digits) -> std::function<void()> {
+      BigInteger lhs = RandomBigInteger(digits, 1);
+      BigInteger rhs =
+          RandomBigInteger(half_rhs ? HalfDigits(digits) : digits, 2);
+      return [op, lhs, rhs] { sink += op(lhs, rhs).GetBlocks().size(); };
+    };
+  };
+  benchmarks.push_back({"add", binary(std::plus<>(), false), {}});
+  benchmarks.push_back({"multiply", binary(std::multiplies<>(), false), {}});
+  benchmarks.push_back({"divide", binary(std::divides<>(), true), {}});
+  benchmarks.push_back({"modulo", binary(std::modulus<>(), true), {}});
+
+  benchmarks.push_back({"to_string",
+                        [](size_t digits) -> std::function<void()> {
+                          BigInteger value = RandomBigInteger(digits, 1);
+                          return [value] { sink += value.toString().size(); };
+                        },
+                        {}});
+  benchmarks.push_back({"parse",
+                        [](size_t digits) -> std::function<void()> {
+                          std::string str = RandomDigits(digits, 1);
+                          return [str] {
+                            sink += BigInteger(str.c_str()).GetBlocks().size();
+                          };
+                        },
+                        {}});
+
+  // Для Rational размер — число цифр числителя и знаменателя
+  auto rational = [](size_t digits) {
+    return std::pair<BigInteger, BigInteger>(RandomBigInteger(digits, 3),
+                                             RandomBigInteger(digits, 4));
+  };
+  benchmarks.push_back({"rational_add",
+                        [rational](size_t digits) -> std::function<void()> {
+                          auto [num, den] = rational(digits);
+                          Rational lhs(num, den);
+                          Rational rhs(den, num + 1);
+                          return [lhs, rhs] {
+                            Rational sum = lhs;
+                            sum += rhs;
+                            sink += sum.GetDenominator().GetBlocks().size();
+                          };
+                        },
+                        {}});
+  benchmarks.push_back({"rational_simplify",  // Simplify через конструктор
+                        [rational](size_t digits) -> std::function<void()> {
+                          auto [num, den] = rational(digits);
+                          return [num, den] {
+                            sink += Rational(num, den)
+                                        .GetDenominator()
+                                        .GetBlocks()
+                                        .size();
+                          };
+                        },
+                        {}});
+  benchmarks.push_back({"rational_as_decimal",
+                        [rational](size_t digits) -> std::function<void()> {
+                          auto [num, den] = rational(digits);
+                          Rational value(num, den);
+                          return [value, digits] {
+                            sink += value.asDecimal(digits).size();
+                          };
+                        },
+                        {}});
+  benchmarks.push_back({"rational_to_double",
+                        [rational](size_t digits) -> std::function<void()> {
+                          auto [num, den] = rational(digits);
+                          Rational value(num, den);
+                          return [value] {
+                            sink += static_cast<size_t>(
+                                static_cast<double>(value) != 0);
+                          };
+                        },
+                        {}});
+
+#ifdef NENIY_HAVE_GMP
+  // Замер GMP привязывается к операции по имени; неизвестное имя (например,
+  // после переименования) останавливает запуск, а не подменяет замер
+  auto gmp_setup = [&benchmarks](const std::string& name) -> Setup& {
+    for (Benchmark& benchmark : benchmarks) {
+      if (benchmark.name == name) {
+        return benchmark.gmp_setup;
+      }
+    }
+    std::cerr << "No benchmark named " << name << '\n';
+    std::exit(EXIT_FAILURE);
+  };
+
+  // mpz_t нельзя копировать в лямбду, поэтому числа живут в shared_ptr
+  struct Mpz {
+    Mpz() { mpz_init(value); }
+    ~Mpz() { mpz_clear(value); }
+    mpz_t value;
+  };
+  auto mpz = [](size_t digits, uint64_t seed) {
+    auto number = std::make_shared<Mpz>();
+    mpz_set_str(number->value, RandomDigits(digits, seed).c_str(), 10);
+    return number;
+  };
+  auto gmp_binary = [mpz](void (*op)(mpz_ptr, mpz_srcptr, mpz_srcptr),
+                          bool half_rhs) -> Setup {
+    return [mpz, op, half_rhs](size_t digits) -> std::function<void()> {
+      auto lhs = mpz(digits, 1);
+      auto rhs = mpz(half_rhs ? HalfDigits(digits) : digits, 2);
+      auto result = std::make_shared<Mpz>();
+      return [op, lhs, rhs, result] {
+        op(result->value, lhs->value, rhs->value);
+        sink += mpz_size(result->value);
+      };
+    };
+  };
+  gmp_setup("add") = gmp_binary(mpz_add, false);
+  gmp_setup("multiply") = gmp_binary(mpz_mul, false);
+  gmp_setup("divide") = gmp_binary(mpz_tdiv_q, true);
+  gmp_setup("modulo") = gmp_binary(mpz_tdiv_r, true);
+  gmp_setup("to_string") = [mpz](size_t digits) -> std::function<void()> {
+    auto value = mpz(digits, 1);
+    return [value] {
+      char* str = mpz_get_str(nullptr, 10, value->value);
+      sink += strlen(str);
+      void (*free_function)(void*, size_t);
+      mp_get_memory_functions(nullptr, nullptr, &free_function);
+      free_function(str, strlen(str) + 1);
+    };
+  };
+  gmp_setup("parse") = [](size_t digits) -> std::function<void()> {
+    std::string str = RandomDigits(digits, 1);
+    auto value = std::make_shared<Mpz>();
+    return [str, value] {
+      mpz_set_str(value->value, str.c_str(), 10);
+      sink += mpz_size(value->value);
+    };
+  };
+
+  struct Mpq {
+    Mpq() { mpq_init(value); }
+    ~Mpq() { mpq_clear(value); }
+    mpq_t value;
+  };
+  auto mpq = [](size_t digits, uint64_t num_seed, uint64_t den_seed) {
+    auto number = std::make_shared<Mpq>();
+    mpz_set_str(mpq_numref(number->value),
+                RandomDigits(digits, num_seed).c_str(), 10);
+    mpz_set_str(mpq_denref(number->value),
+                RandomDigits(digits, den_seed).c_str(), 10);
+    return number;
+  };
+  gmp_setup("rational_add") = [mpq](size_t digits) -> std::function<void()> {
+    auto lhs = mpq(digits, 3, 4);
+    auto rhs = mpq(digits, 4, 3);
+    mpq_canonicalize(lhs->value);
+    mpq_canonicalize(rhs->value);
+    auto sum = std::make_shared<Mpq>();
+    return [lhs, rhs, sum] {
+      mpq_add(sum->value, lhs->value, rhs->value);
+      sink += mpz_size(mpq_denref(sum->value));
+    };
+  };
+  gmp_setup("rational_simplify") =
+      [mpq](size_t digits) -> std::function<void()> {
+    auto source = mpq(digits, 3, 4);
+    auto value = std::make_shared<Mpq>();
+    return [source, value] {
+      mpq_set(value->value, source->value);
+      mpq_canonicalize(value->value);
+      sink += mpz_size(mpq_denref(value->value));
+    };
+  };
+  gmp_setup("rational_to_double") =
+      [mpq](size_t digits) -> std::function<void()> {
+    auto value = mpq(digits, 3, 4);
+    mpq_canonicalize(value->value);
+    return [value] {
+      sink += static_cast<size_t>(mpq_get_d(value->value) != 0);
+    };
+  };
+#endif
+
+  return benchmarks;
+}
+
+Options ParseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (i + 1 == argc) {
+      std::cerr << "Missing value for " << arg << '\n';
+      std::exit(EXIT_FAILURE);
+    }
+    std::string value = argv[++i];
+    if (arg == "--max-digits") {
+      options.max_digits = std::stoull(value);
+    } else if (arg == "--min-time") {
+      options.min_time = std::stod(value);
+    } else if (arg == "--budget") {
+      options.budget = std::stod(value);
+    } else if (arg == "--out") {
+      options.out = value;
+    } else {
+      std::cerr << "Unknown option " << arg << '\n';
+      std::exit(EXIT_FAILURE);
+    }
+  }
+  return options;
+}
+
+void RunOne(const Setup& setup, size_t digits, const Options& options,
+            BudgetGuard& guard, std::ostream& json) {
+  if (guard.ShouldSkip()) {
+    json << "\"skipped\": true";
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  std::function<void()> body = setup(digits);
+  double setup_seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  Measurement measurement = Measure(body, options.min_time);
+  double seconds_per_op = measurement.seconds / measurement.iterations;
+  json << "\"iterations\": " << measurement.iterations
+       << ", \"ns_per_op\": " << seconds_per_op * 1e9;
+  guard.Record(setup_seconds + seconds_per_op);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options = ParseOptions(argc, argv);
+
+  std::vector<size_t> sizes;
+  for (size_t digits = 1; digits <= options.max_digits; digits *= 10) {
+    sizes.push_back(digits);
+  }
+
+  std::ostringstream json;
+  json << "{\n  \"context\": {\"block_digits\": " << BigInteger::cBlockSize
+       << ", \"min_time\": " << options.min_time
+       << ", \"budget\": " << options.budget
+#ifdef NENIY_HAVE_GMP
+       << ", \"gmp\": \"" << gmp_version << "\""
+#endif
+       << "},\n  \"benchmarks\": [";
+  bool first = true;
+  for (const Benchmark& benchmark : MakeBenchmarks()) {
+    BudgetGuard guard(options.budget);
+    BudgetGuard gmp_guard(options.budget);
+    for (size_t digits : sizes) {
+      json << (first ? "\n" : ",\n") << "    {\"name\": \"" << benchmark.name
+           << "\", \"digits\": " << digits << ", ";
+      first = false;
+      RunOne(benchmark.setup, digits, options, guard, json);
+      if (benchmark.gmp_setup) {
+        json << ", \"gmp\": {";
+        RunOne(benchmark.gmp_setup, digits, options, gmp_guard, json);
+        json << "}";
+      }
+      json << "}";
+      std::cerr << benchmark.name << ' ' << digits << " done\n";
+    }
+  }
+  json << "\n  ]\n}\n";
+
+  if (options.out.empty()) {
+    std::cout << json.str();
+  } else {
+    std::ofstream(options.out) << json.str();
+  }
+  return sink == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,497 @@
+// Рандомизированные дифференциальные тесты BigInteger и Rational: маленькие
+// числа сверяются с __int128, большие — с алгебраическими тождествами и, если
+// доступен, с GMP.
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+#include "BigInteger.h"
+#include "BigIntegerAsync.h"
+#include "Rational.h"
+
+#ifdef NENIY_HAVE_GMP
+#include <gmp.h>
+#endif
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                               \
+  do {                                                                 \
+    if (!(condition)) {                                                \
+      std::cerr << __FILE__ << ':' << __LINE__ << ": CHECK failed: "   \
+                << #condition << '\n';                                 \
+      ++failures;                                                      \
+    }                                                                  \
+  } while (false)
+
+#define CHECK_EQ(lhs, rhs)                                             \
+  do {                                                                 \
+    auto lhs_value = (lhs);                                            \
+    auto rhs_value = (rhs);                                            \
+    if (!(lhs_value == rhs_value)) {                                   \
+      std::cerr << __FILE__ << ':' << __LINE__ << ": CHECK_EQ failed: " \
+                << #lhs << " == " << #rhs << "\n  " << lhs_value       \
+                << "\n  " << rhs_value << '\n';                        \
+      ++failures;                                                      \
+    }                                                                  \
+  } while (false)
+
+std::mt19937_64 rng(20261018);
+
+std::string Int128ToString(__int128 value) {
+  if (value == 0) {
+    return "0";
+  }
+  bool negative = value < 0;
+  unsigned __int128 magnitude =
+      negative ? -static_cast<unsigned __int128>(value) : value;
+  std::string str;
+  while (magnitude != 0) {
+    str.push_back(static_cast<char>('0' + magnitude % 10));
+    magnitude /= 10;
+  }
+  if (negative) {
+    str.push_back('-');
+  }
+  return std::string(str.rbegin(), str.rend());
+}
+
+BigInteger FromInt128(__int128 value) {
+  return BigInteger(Int128ToString(value).c_str());
+}
+
+int64_t RandomInt64() {  // Случайная длина, чтобы покрыть 1 и 2 блока
+  int64_t value = static_cast<int64_t>(rng() >> (1 + rng() % 63));
+  return (rng() & 1) != 0 ? -value : value;
+}
+
+std::string RandomDigits(size_t digits, bool allow_negative = true) {
+  std::string str;
+  if (allow_negative && (rng() & 1) != 0) {
+    str.push_back('-');
+  }
+  str.push_back(static_cast<char>('1' + rng() % 9));
+  for (size_t i = 1; i < digits; ++i) {
+    str.push_back(static_cast<char>('0' + rng() % 10));
+  }
+  return str;
+}
+
+BigInteger Abs(BigInteger value) {
+  if (value.IsNegative()) {
+    value.FlipSign();
+  }
+  return value;
+}
+
+template <typename Exception, typename Body>
+bool Throws(Body body) {
+  try {
+    body();
+  } catch (const Exception&) {
+    return true;
+  }
+  return false;
+}
+
+BigInteger PowerOfTwo(size_t exponent) {
+  BigInteger result = 1;
+  for (size_t i = 0; i < exponent; ++i) {
+    result *= 2;
+  }
+  return result;
+}
+
+void TestSmallAgainstInt128() {
+  for (int iteration = 0; iteration < 20000; ++iteration) {
+    __int128 a = RandomInt64();
+    __int128 b = RandomInt64();
+    BigInteger lhs = FromInt128(a);
+    BigInteger rhs = FromInt128(b);
+
+    CHECK_EQ(lhs.toString(), Int128ToString(a));
+    CHECK_EQ((lhs + rhs).toString(), Int128ToString(a + b));
+    CHECK_EQ((lhs - rhs).toString(), Int128ToString(a - b));
+    CHECK_EQ((lhs * rhs).toString(), Int128ToString(a * b));
+    if (b != 0) {
+      CHECK_EQ((lhs / rhs).toString(), Int128ToString(a / b));
+      CHECK_EQ((lhs % rhs).toString(), Int128ToString(a % b));
+    }
+    CHECK((lhs < rhs) == (a < b));
+    CHECK((lhs == rhs) == (a == b));
+
+    CHECK_EQ((lhs & rhs).toString(), Int128ToString(a & b));
+    CHECK_EQ((lhs | rhs).toString(), Int128ToString(a | b));
+    CHECK_EQ((lhs ^ rhs).toString(), Int128ToString(a ^ b));
+    CHECK_EQ((~lhs).toString(), Int128ToString(~a));
+    size_t shift = rng() % 64;
+    CHECK_EQ((lhs << shift).toString(),
+             Int128ToString(a * (__int128{1} << shift)));
+    CHECK_EQ((lhs >> shift).toString(), Int128ToString(a >> shift));
+    size_t bit = rng() % 130;
+    CHECK(lhs.TestBit(bit) ==
+          (((a >> std::min<size_t>(bit, 127)) & 1) != 0));
+
+    // Те же операции над числами, у которых есть только двоичная форма
+    BigInteger lhs_bits = lhs << 0;
+    BigInteger rhs_bits = rhs << 0;
+    CHECK_EQ((lhs_bits & rhs_bits).toString(), Int128ToString(a & b));
+    CHECK_EQ((lhs_bits | rhs).toString(), Int128ToString(a | b));
+    CHECK_EQ((lhs ^ rhs_bits).toString(), Int128ToString(a ^ b));
+    CHECK_EQ((~lhs_bits).toString(), Int128ToString(~a));
+    CHECK_EQ((lhs_bits >> shift).toString(), Int128ToString(a >> shift));
+    CHECK_EQ((lhs_bits + rhs_bits).toString(), Int128ToString(a + b));
+    CHECK(lhs_bits.TestBit(bit) == lhs.TestBit(bit));
+    CHECK_EQ(lhs_bits.BitLength(), lhs.BitLength());
+    CHECK_EQ(lhs_bits.TrailingZeroBits(), lhs.TrailingZeroBits());
+    CHECK_EQ(lhs_bits.PopCount(), lhs.PopCount());
+    BigInteger incremented = lhs_bits;
+    CHECK_EQ((++incremented).toString(), Int128ToString(a + 1));
+
+    BigInteger copy = lhs;
+    CHECK_EQ((++copy).toString(), Int128ToString(a + 1));
+    copy = lhs;
+    CHECK_EQ((--copy).toString(), Int128ToString(a - 1));
+  }
+  CHECK_EQ(BigInteger(INT_MIN).toString(), std::to_string(INT_MIN));
+}
+
+void TestLargeIdentities() {
+  for (size_t digits : {1, 8, 9, 10, 17, 18, 19, 50, 200, 1000, 3000}) {
+    for (int iteration = 0; iteration < 10; ++iteration) {
+      std::string a_str = RandomDigits(digits);
+      std::string b_str = RandomDigits(1 + rng() % digits);
+      BigInteger a(a_str.c_str());
+      BigInteger b(b_str.c_str());
+
+      CHECK_EQ(a.toString(), a_str);
+      CHECK_EQ((a + b) - b, a);
+      CHECK_EQ(a * b, b * a);
+      CHECK_EQ((a * b) / b, a);
+      BigInteger quotient = a / b;
+      BigInteger remainder = a % b;
+      CHECK_EQ(quotient * b + remainder, a);
+      CHECK(Abs(remainder) < Abs(b));
+      CHECK(remainder.IsZero() || remainder.IsNegative() == a.IsNegative());
+
+      size_t shift = rng() % 200;
+      CHECK_EQ(a << shift, a * PowerOfTwo(shift));
+      CHECK_EQ((a << shift) >> shift, a);
+      CHECK_EQ((a & b) + (a | b), a + b);
+      CHECK_EQ(a ^ b ^ b, a);
+      CHECK_EQ(~~a, a);
+      CHECK_EQ(((2 * a + 1) << shift).TrailingZeroBits(), shift);
+      CHECK_EQ(a.TestBit(shift), (a >> shift) % 2 != 0);
+      CHECK_EQ(a & ((1_bi << shift) - 1), a - ((a >> shift) << shift));
+      CHECK_EQ((1_bi << shift).BitLength(), shift + 1);
+      CHECK_EQ(((1_bi << (shift + 1)) - 1).BitLength(), shift + 1);
+      BigInteger magnitude = Abs(a);
+      CHECK(1_bi << (magnitude.BitLength() - 1) <= magnitude);
+      CHECK(magnitude < 1_bi << magnitude.BitLength());
+
+      std::vector<char> buffer(digits * 4 + 16);
+      for (int base : {2, 8, 10, 16, 36}) {
+        auto written =
+            to_chars(buffer.data(), buffer.data() + buffer.size(), a, base);
+        CHECK(written.ec == std::errc());
+        BigInteger parsed;
+        auto read = from_chars(buffer.data(), written.ptr, parsed, base);
+        CHECK(read.ec == std::errc() && read.ptr == written.ptr);
+        CHECK_EQ(parsed, a);
+
+        size_t length = written.ptr - buffer.data();
+        auto short_write =
+            to_chars(buffer.data(), buffer.data() + length - 1, a, base);
+        CHECK(short_write.ec == std::errc::value_too_large);
+      }
+
+      std::vector<unsigned char> bytes(a.SerializedSize());
+      CHECK_EQ(a.Serialize(bytes.data(), bytes.size()), bytes.size());
+      CHECK_EQ(BigInteger(BigIntegerView(bytes.data(), bytes.size())), a);
+
+      CHECK(Throws<std::length_error>(
+          [&] { a.Serialize(bytes.data(), bytes.size() - 1); }));
+      CHECK(Throws<std::runtime_error>(
+          [&] { BigIntegerView(bytes.data(), bytes.size() - 1); }));
+      std::vector<unsigned char> corrupted = bytes;
+      corrupted[0] = BigInteger::cSerialVersion + 1;
+      CHECK(Throws<std::runtime_error>(
+          [&] { BigIntegerView(corrupted.data(), corrupted.size()); }));
+      corrupted = bytes;
+      corrupted[BigInteger::cSerialHeaderSize + 3] = 0xFF;  // Блок >= 10^9
+      CHECK(Throws<std::runtime_error>(
+          [&] { BigIntegerView(corrupted.data(), corrupted.size()); }));
+    }
+  }
+}
+
+void TestBinaryForm() {
+  // Степени двойки после сдвига не переводятся в десятичный вид
+  BigInteger power = 1_bi << 1'000'000;
+  CHECK_EQ(power.BitLength(), 1'000'001U);
+  CHECK_EQ(power.TrailingZeroBits(), 1'000'000U);
+  CHECK_EQ((power >> 999'999).toString(), "2");
+  CHECK_EQ(((-power) >> 1'000'001).toString(), "-1");
+  CHECK_EQ(((1_bi << 100'000) - 1).PopCount(), 100'000U);
+
+  BigInteger a(RandomDigits(3000).c_str());
+  CHECK_EQ((a << 100'000) >> 100'000, a);
+  CHECK_EQ(((a << 1000) | a) - (a << 1000), a & ~(a << 1000));
+
+  // Десятичная форма достраивается в const-методах из нескольких потоков
+  BigInteger shared = a << 5;
+  std::string expected = (a * 32).toString();
+  std::vector<std::thread> threads;
+  std::vector<std::string> results(4);
+  for (std::string& result : results) {
+    threads.emplace_back([&shared, &result] { result = shared.toString(); });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const std::string& result : results) {
+    CHECK_EQ(result, expected);
+  }
+}
+
+void TestFromCharsErrors() {
+  BigInteger value = 42;
+  for (std::string_view str : {"", "-", "xyz", "-+1", "g"}) {
+    auto result = from_chars(str, value, 16);
+    CHECK(result.ec == std::errc::invalid_argument);
+    CHECK(result.ptr == str.data());
+    CHECK_EQ(value, 42);  // Значение не меняется при ошибке
+  }
+  auto partial = from_chars(std::string_view("12z"), value);
+  CHECK(partial.ec == std::errc() && *partial.ptr == 'z');
+  CHECK_EQ(value, 12);
+}
+
+void TestRational() {
+  CHECK_EQ(Rational(1, 7).asDecimal(12), "0.142857142857");
+  CHECK_EQ(Rational(-2, 3).asDecimal(3), "-0.667");
+  CHECK_EQ(Rational(6, -4).toString(), "-3/2");
+  CHECK_EQ((Rational(3, 8) << 5).toString(), "12");
+  CHECK_EQ((Rational(-3, 2) >> 3).toString(), "-3/16");
+
+  for (size_t digits : {1, 5, 20, 60}) {
+    for (int iteration = 0; iteration < 10; ++iteration) {
+      BigInteger num(RandomDigits(digits).c_str());
+      BigInteger den(RandomDigits(digits, false).c_str());
+      BigInteger other(RandomDigits(digits, false).c_str());
+      Rational x(num, den);
+      Rational y(other, num);
+      CHECK_EQ(((x + y) - y).toString(), x.toString());
+      CHECK_EQ(((x * y) / y).toString(), x.toString());
+      CHECK_EQ(Rational(num * other, den * other).toString(), x.toString());
+    }
+  }
+}
+
+template <typename T>
+bool IsCancelled(std::future<T>& future) {
+  try {
+    future.get();
+  } catch (const OperationCancelled&) {
+    return true;
+  }
+  return false;
+}
+
+void TestAsync() {
+  BigInteger a(RandomDigits(2000).c_str());
+  BigInteger b(RandomDigits(700).c_str());
+
+  CHECK_EQ(MultiplyAsync(a, b).get(), a * b);
+  auto [quotient, remainder] = DivModAsync(a, b).get();
+  CHECK_EQ(quotient, a / b);
+  CHECK_EQ(remainder, a % b);
+  CHECK_EQ(ToStringAsync(a).get(), a.toString());
+  CHECK_EQ(ToStringAsync(255_bi, 16).get(), "ff");
+  CHECK_EQ(AsDecimalAsync(Rational(1, 7), 12).get(), "0.142857142857");
+  CHECK_EQ(FromStringAsync(ToStringAsync(a, 7).get(), 7).get(), a);
+  auto malformed = FromStringAsync("12z", 10);
+  CHECK(Throws<std::invalid_argument>([&] { malformed.get(); }));
+
+  // Задача выполняется сразу, поэтому прогресс проверяется детерминированно
+  Executor inline_executor = [](std::function<void()> task) { task(); };
+  std::vector<double> progress;
+  OperationControl control({}, [&progress](double fraction) {
+    progress.push_back(fraction);
+  });
+  for (int run = 0; run < 2; ++run) {  // Контроль можно переиспользовать
+    progress.clear();
+    CHECK_EQ(MultiplyAsync(a, b, control, inline_executor).get(), a * b);
+    CHECK(progress.size() > 10);
+    CHECK(std::is_sorted(progress.begin(), progress.end()));
+    CHECK(!progress.empty() && progress.back() == 1.0);
+  }
+  progress.clear();
+  CHECK_EQ(a.DivideWithRemainder(b, control).first, a / b);
+  CHECK(!progress.empty() && progress.back() == 1.0);
+
+  CancellationToken token;
+  token.Cancel();
+  auto cancelled = DivModAsync(a, b, OperationControl(token));
+  CHECK(IsCancelled(cancelled));
+  auto cancelled_decimal =
+      AsDecimalAsync(Rational(1, 3), 1000, OperationControl(token));
+  CHECK(IsCancelled(cancelled_decimal));
+
+  OperationControl expired;
+  expired.SetDeadline(OperationControl::Clock::now());
+  auto timed_out = ToStringAsync(a, 7, expired);
+  CHECK(IsCancelled(timed_out));
+  auto parse_timed_out = FromStringAsync(ToStringAsync(a, 7).get(), 7, expired);
+  CHECK(IsCancelled(parse_timed_out));
+  BigInteger unchanged = 42;
+  std::string digits = a.toString();
+  CHECK(Throws<OperationCancelled>([&] {
+    unchanged.FromChars(digits.data(), digits.data() + digits.size(), 16,
+                        expired);
+  }));
+  CHECK_EQ(unchanged, 42);
+
+  // Срок соблюдается и внутри одного этапа asDecimal: знаменатель 2^33000
+  // (около 10^4 цифр), так что каждое деление само по себе долгое
+  BigInteger numerator(RandomDigits(20000, false).c_str());
+  Rational huge = Rational(2 * numerator + 1) >> 33000;
+  OperationControl deadline;
+  auto start = OperationControl::Clock::now();
+  deadline.SetDeadline(start + std::chrono::milliseconds(10));
+  auto bounded = AsDecimalAsync(huge, 5, deadline);
+  CHECK(IsCancelled(bounded));
+  CHECK(OperationControl::Clock::now() - start <
+        std::chrono::milliseconds(100));
+}
+
+#ifdef NENIY_HAVE_GMP
+std::string MpzToString(const mpz_t value) {
+  std::string str(mpz_sizeinbase(value, 10) + 2, '\0');
+  mpz_get_str(str.data(), 10, value);
+  str.resize(strlen(str.c_str()));
+  return str;
+}
+
+void TestAgainstGmp() {
+  mpz_t a;
+  mpz_t b;
+  mpz_t result;
+  mpz_inits(a, b, result, nullptr);
+  for (size_t digits : {10, 100, 1000, 5000}) {
+    for (int iteration = 0; iteration < 5; ++iteration) {
+      std::string a_str = RandomDigits(digits);
+      std::string b_str = RandomDigits(1 + rng() % digits);
+      mpz_set_str(a, a_str.c_str(), 10);
+      mpz_set_str(b, b_str.c_str(), 10);
+      BigInteger lhs(a_str.c_str());
+      BigInteger rhs(b_str.c_str());
+
+      mpz_add(result, a, b);
+      CHECK_EQ((lhs + rhs).toString(), MpzToString(result));
+      mpz_sub(result, a, b);
+      CHECK_EQ((lhs - rhs).toString(), MpzToString(result));
+      mpz_mul(result, a, b);
+      CHECK_EQ((lhs * rhs).toString(), MpzToString(result));
+      mpz_tdiv_q(result, a, b);
+      CHECK_EQ((lhs / rhs).toString(), MpzToString(result));
+      mpz_tdiv_r(result, a, b);
+      CHECK_EQ((lhs % rhs).toString(), MpzToString(result));
+      mpz_and(result, a, b);
+      CHECK_EQ((lhs & rhs).toString(), MpzToString(result));
+      mpz_fdiv_q_2exp(result, a, digits);
+      CHECK_EQ((lhs >> digits).toString(), MpzToString(result));
+    }
+  }
+  mpz_clears(a, b, result, nullptr);
+}
+#endif
+
+#ifdef NENIY_BIGINTEGER_STATS
+void TestStats() {
+  using Stats = BigIntegerStats;
+  BigInteger lhs = "123456789123456789"_bi;
+  BigInteger rhs = "987654321987654321"_bi;
+
+  Stats::Reset();
+  BigInteger product = lhs * rhs;
+  Stats::Snapshot snapshot = Stats::TakeSnapshot();
+  CHECK_EQ(snapshot.operations[Stats::kMultiply].calls, 1U);
+  CHECK_EQ(snapshot.operations[Stats::kMultiply].size_histogram[2], 1U);
+  CHECK(snapshot.allocations > 0);
+
+  // Умножения и вычитания внутри DivMod не считаются отдельными вызовами,
+  // но видны в inclusive_calls, а их выделения памяти — в выделениях DivMod
+  Stats::Reset();
+  (void)(product / rhs);
+  snapshot = Stats::TakeSnapshot();
+  CHECK_EQ(snapshot.operations[Stats::kDivMod].calls, 1U);
+  CHECK_EQ(snapshot.operations[Stats::kDivMod].inclusive_calls, 1U);
+  CHECK_EQ(snapshot.operations[Stats::kMultiply].calls, 0U);
+  CHECK(snapshot.operations[Stats::kMultiply].inclusive_calls > 0);
+  CHECK_EQ(snapshot.operations[Stats::kSubtract].calls, 0U);
+  CHECK(snapshot.operations[Stats::kSubtract].inclusive_calls > 0);
+  CHECK(snapshot.operations[Stats::kDivMod].nanoseconds > 0);
+  CHECK_EQ(snapshot.operations[Stats::kMultiply].nanoseconds, 0U);
+  CHECK(snapshot.operations[Stats::kDivMod].allocations > 0);
+  CHECK(snapshot.operations[Stats::kDivMod].allocated_bytes > 0);
+  CHECK_EQ(snapshot.operations[Stats::kMultiply].allocations, 0U);
+  // Копия делимого в operator/ сделана вне DivMod
+  CHECK(snapshot.operations[Stats::kDivMod].allocations <
+        snapshot.allocations);
+
+  // Деления внутри Rational видны только как вложенные
+  Stats::Reset();
+  Rational difference = Rational(1, 3) - Rational(1, 6);
+  Rational quotient = difference / Rational(5, 7);
+  snapshot = Stats::TakeSnapshot();
+  CHECK_EQ(quotient.toString(), "7/30");
+  CHECK_EQ(snapshot.operations[Stats::kRationalSubtract].calls, 1U);
+  CHECK_EQ(snapshot.operations[Stats::kRationalDivide].calls, 1U);
+  CHECK_EQ(snapshot.operations[Stats::kRationalAdd].calls, 0U);
+  CHECK_EQ(snapshot.operations[Stats::kRationalMultiply].calls, 0U);
+  CHECK_EQ(snapshot.operations[Stats::kDivMod].calls, 0U);
+  CHECK(snapshot.operations[Stats::kDivMod].inclusive_calls > 0);
+  CHECK(snapshot.operations[Stats::kRationalSimplify].inclusive_calls >
+        snapshot.operations[Stats::kRationalSimplify].calls);
+
+  Stats::Reset();
+  (void)(lhs + -rhs);
+  snapshot = Stats::TakeSnapshot();
+  CHECK_EQ(snapshot.operations[Stats::kAdd].calls, 1U);
+  CHECK_EQ(snapshot.operations[Stats::kSubtract].calls, 0U);
+
+  Stats::Reset();
+  snapshot = Stats::TakeSnapshot();
+  CHECK_EQ(snapshot.operations[Stats::kDivMod].calls, 0U);
+  CHECK_EQ(snapshot.operations[Stats::kDivMod].inclusive_calls, 0U);
+  CHECK_EQ(snapshot.operations[Stats::kDivMod].allocations, 0U);
+  CHECK_EQ(snapshot.allocations, 0U);
+}
+#endif
+
+}  // namespace
+
+int main() {
+  TestSmallAgainstInt128();
+  TestLargeIdentities();
+  TestBinaryForm();
+  TestFromCharsErrors();
+  TestRational();
+  TestAsync();
+#ifdef NENIY_HAVE_GMP
+  TestAgainstGmp();
+#endif
+#ifdef NENIY_BIGINTEGER_STATS
+  TestStats();
+#endif
+  if (failures != 0) {
+    std::cerr << failures << " check(s) failed\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << "All tests passed\n";
+  return EXIT_SUCCESS;
+}